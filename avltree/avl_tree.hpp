@@ -4,14 +4,30 @@
 #include <algorithm>
 #include <cassert>
 #include <memory>
+#include <concepts>
+#include <new>
+#include <limits>
+#include <cstddef>
+#include <utility>
+#include <array>
+#include <span>
+#include <bit>
+#include <ranges>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+#include "balance_policy.hpp"
 
 namespace avl {
 
-static constexpr int MIN_BALANCE = -1;
-static constexpr int MAX_BALANCE =  1;
+static constexpr char key_request    = 'k';
+static constexpr char query_request  = 'q';
+static constexpr char window_request = 'w';
 
-static constexpr char key_request   = 'k';
-static constexpr char query_request = 'q';
+static constexpr size_t DEFAULT_LOOKUP_GROUP = 16;
+static constexpr size_t MAX_LOOKUP_GROUP     = 64;
 
 enum class FindFlags {
     left,
@@ -19,30 +35,60 @@ enum class FindFlags {
     exists
 };
 
-enum class RotationDirection {
-    left,
-    right
+enum class CompactOrder {
+    in_order,
+    breadth_first
+};
+
+// Per-node data derived from the node and its children. update() runs wherever the subtree
+// size is recomputed: inserts, rotations, joins and bulk builds.
+struct no_augment final {
+    struct value_type {};
+
+    template <typename Node>
+    static void update(Node&) noexcept {}
 };
 
-template <typename KeyType>
+template <typename KeyType, typename BalancePolicy = avl_balance, typename Augment = no_augment>
 class avl_tree final {
+    friend BalancePolicy;
+
  private:
+    // Nodes placed into a contiguous block by compact() are destroyed without being freed.
+    // Not final: an empty deleter has to stay a base of unique_ptr to keep the links pointer-sized.
+    struct node_deleter {
+        template <typename Node>
+        void operator()(Node* node) const noexcept {
+            if (node->pooled_)
+                node->~Node();
+            else
+                delete node;
+        }
+    };
+
+    class avl_node;
+    using node_ptr = std::unique_ptr<avl_node, node_deleter>;
+    static_assert(sizeof(node_ptr) == sizeof(avl_node*));
+
     class avl_node final {
      public:
         KeyType key_;
-        size_t height_;
-        size_t subtree_size_;
+        size_t height_; // balance data, see balance_policy.hpp
+        size_t subtree_size_ : std::numeric_limits<size_t>::digits - 1;
+        size_t pooled_ : 1;
+        [[no_unique_address]] typename Augment::value_type augment_{};
         avl_node* parent_;
-        std::unique_ptr<avl_node> left_;
-        std::unique_ptr<avl_node> right_;
+        node_ptr left_;
+        node_ptr right_;
 
      public:
         avl_node(KeyType key, size_t height = 1, size_t subtree_size = 1,
-                 avl_node* parent = nullptr, std::unique_ptr<avl_node> left = nullptr,
-                 std::unique_ptr<avl_node> right = nullptr):
+                 avl_node* parent = nullptr, node_ptr left = nullptr,
+                 node_ptr right = nullptr):
         key_(key),
         height_(height),
         subtree_size_(subtree_size),
+        pooled_(false),
         parent_(parent),
         left_(std::move(left)),
         right_(std::move(right)) {};
@@ -83,6 +129,7 @@ class avl_tree final {
             subtree_size_ = 1;
             subtree_size_ += left_.get()  ? left_->getSubtreeSize() : 0;
             subtree_size_ += right_.get() ? right_->getSubtreeSize() : 0;
+            Augment::update(*this);
         }
 
         size_t getSmallerKeysCount() const {
@@ -125,6 +172,18 @@ class avl_tree final {
         return node;
     }
 
+    static avl_node* successor(avl_node* node) {
+        if (node->right_)
+            return findMin(node->right_.get());
+
+        auto parent = node->parent_;
+        while (parent && node == parent->right_.get()) {
+            node   = parent;
+            parent = parent->parent_;
+        }
+        return parent;
+    }
+
  public:
     class avl_iterator final {
      public:
@@ -135,6 +194,7 @@ class avl_tree final {
         using pointer           = const avl_node* const&;
 
     private:
+        friend avl_tree;
         avl_node* node_;
     public:
         explicit avl_iterator(avl_node* node = nullptr) : node_(node) {}
@@ -147,19 +207,7 @@ class avl_tree final {
             if (!node_)
                 return *this;
 
-            if (node_->right_) {
-                node_ = node_->right_.get();
-                node_ = findMin(node_);
-            }
-            else {
-                auto parent = node_->parent_;
-                while (parent && node_ == parent->right_.get()) {
-                    node_  = parent;
-                    parent = parent->parent_;
-                }
-                node_ = parent;
-            }
-
+            node_ = successor(node_);
             return *this;
         }
 
@@ -180,33 +228,111 @@ class avl_tree final {
         }
     };
 
+    // Same walk as avl_iterator, but dereferences to the key itself.
+    class key_iterator final {
+     public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = KeyType;
+        using difference_type   = std::ptrdiff_t;
+        using reference         = const KeyType&;
+        using pointer           = const KeyType*;
+
+     private:
+        avl_node* node_ = nullptr;
+     public:
+        key_iterator() = default;
+        explicit key_iterator(avl_node* node) : node_(node) {}
+
+        key_iterator& operator++() {
+            if (node_)
+                node_ = successor(node_);
+            return *this;
+        }
+
+        key_iterator operator++(int) {
+            key_iterator copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        bool operator==(const key_iterator& other) const noexcept = default;
+
+        const KeyType& operator*() const noexcept {
+            return node_->key_;
+        }
+
+        const KeyType* operator->() const noexcept {
+            return &node_->key_;
+        }
+    };
+
+    // Non-owning view over the keys in [first, second]; size() is computed once from subtree sizes.
+    class range_view final : public std::ranges::view_interface<range_view> {
+     private:
+        key_iterator begin_;
+        key_iterator end_;
+        size_t size_ = 0;
+     public:
+        range_view() = default;
+        range_view(key_iterator begin, key_iterator end, size_t size) :
+            begin_(begin), end_(end), size_(size) {}
+
+        key_iterator begin() const noexcept {
+            return begin_;
+        }
+
+        key_iterator end() const noexcept {
+            return end_;
+        }
+
+        size_t size() const noexcept {
+            return size_;
+        }
+    };
+
         using rotate_direction = avl::RotationDirection;
         using find_flag = avl::FindFlags;
         using find_res  = std::pair<avl_node*, find_flag>;
         using iterator  = avl_iterator;
 
-        std::unique_ptr<avl_node> root = nullptr;
+    private:
+        struct node_storage {
+            alignas(avl_node) std::byte bytes[sizeof(avl_node)];
+        };
+
+        std::shared_ptr<node_storage[]> node_block_ = nullptr; // filled by compact(), outlives root
+        size_t node_block_size_ = 0;
+
+    public:
+        node_ptr root = nullptr;
 
     public:
         avl_tree() = default; // constructor
 
-        avl_tree(const avl_tree<KeyType>& other) { // copy constructor
+        avl_tree(const avl_tree& other) { // copy constructor
             root = deep_copy(other);
         }
 
-        avl_tree(avl_tree<KeyType>&& other) noexcept : root{std::move(other.root)} {} // move constructor
+        avl_tree(avl_tree&& other) noexcept : node_block_{std::move(other.node_block_)}, // move constructor
+                                              node_block_size_{std::exchange(other.node_block_size_, 0)},
+                                              root{std::move(other.root)} {}
 
-        avl_tree& operator=(const avl_tree<KeyType>& other) { // copy assignment
+        avl_tree& operator=(const avl_tree& other) { // copy assignment
             auto tmp = deep_copy(other);
             std::swap(root, tmp);
+            tmp.reset(); // the old nodes may live in the block
+            node_block_.reset();
+            node_block_size_ = 0;
             return *this;
         }
 
-        avl_tree& operator=(avl_tree<KeyType>&& other) noexcept { // move assignment
+        avl_tree& operator=(avl_tree&& other) noexcept { // move assignment
             if (this == &other)
                 return *this;
 
             std::swap(root, other.root);
+            std::swap(node_block_, other.node_block_);
+            std::swap(node_block_size_, other.node_block_size_);
             return *this;
         }
 
@@ -238,15 +364,29 @@ class avl_tree final {
             return this->end();
         }
 
+        size_t size() const noexcept {
+            return root ? root->getSubtreeSize() : 0;
+        }
+
+        bool empty() const noexcept {
+            return !root;
+        }
+
  private:
-    std::unique_ptr<avl_node> deep_copy(const avl_tree& other) {
+    template <typename... Args>
+    static node_ptr makeNode(Args&&... args) {
+        return node_ptr(new avl_node(std::forward<Args>(args)...));
+    }
+
+    node_ptr deep_copy(const avl_tree& other) {
         if (!other.root)
             return nullptr;
 
         std::stack<std::pair<const avl_node*, avl_node*>> stack;
         const avl_node* node = other.root.get();
 
-        auto newRoot = std::make_unique<avl_node>(node->key_, node->height_, node->subtree_size_, node->parent_);
+        auto newRoot = makeNode(node->key_, node->height_, node->getSubtreeSize(), node->parent_);
+        newRoot->augment_ = node->augment_;
 
         stack.push({node, newRoot.get()});
 
@@ -255,15 +395,17 @@ class avl_tree final {
             stack.pop();
 
             if (old_node->left_) {
-                new_node->left_ = std::make_unique<avl_node>(old_node->left_->key_, old_node->left_->height_,
-                                                             old_node->left_->subtree_size_, new_node);
+                new_node->left_ = makeNode(old_node->left_->key_, old_node->left_->height_,
+                                                             old_node->left_->getSubtreeSize(), new_node);
+                new_node->left_->augment_ = old_node->left_->augment_;
 
                 stack.push({old_node->left_.get(), new_node->left_.get()});
             }
 
             if (old_node->right_) {
-                new_node->right_ = std::make_unique<avl_node>(old_node->right_->key_, old_node->right_->height_,
-                                                              old_node->right_->subtree_size_, new_node);
+                new_node->right_ = makeNode(old_node->right_->key_, old_node->right_->height_,
+                                                              old_node->right_->getSubtreeSize(), new_node);
+                new_node->right_->augment_ = old_node->right_->augment_;
 
                 stack.push({old_node->right_.get(), new_node->right_.get()});
             }
@@ -273,25 +415,142 @@ class avl_tree final {
     }
 
  public:
-    void insert(const KeyType& key_to_insert) {
-        if (!root) {
-            root = std::make_unique<avl_node>(key_to_insert);
+    struct memory_usage_info {
+        size_t nodes;              // live nodes
+        size_t node_size;          // sizeof one node
+        size_t heap_nodes;         // nodes allocated one by one
+        size_t allocator_overhead; // estimated malloc headers and rounding of heap nodes
+        size_t block_bytes;        // contiguous block owned since the last compact()
+        size_t unused_block_bytes; // block slots that no longer hold a node
+        size_t shared_block_bytes; // block still shared with trees split off by split_before(), not in total()
+
+        size_t total() const noexcept {
+            return heap_nodes * node_size + allocator_overhead + block_bytes;
+        }
+    };
+
+    memory_usage_info memory_usage() const {
+        memory_usage_info info{size(), sizeof(avl_node), 0, 0, 0, 0, 0};
+        bool shared = node_block_.use_count() > 1;
+        (shared ? info.shared_block_bytes : info.block_bytes) = node_block_size_ * sizeof(node_storage);
+
+        size_t pooled = 0;
+        std::vector<const avl_node*> stack;
+        if (root)
+            stack.push_back(root.get());
+
+        while (!stack.empty()) {
+            const avl_node* node = stack.back();
+            stack.pop_back();
+
+            node->pooled_ ? ++pooled : ++info.heap_nodes;
+            if (node->left_)
+                stack.push_back(node->left_.get());
+            if (node->right_)
+                stack.push_back(node->right_.get());
+        }
+
+        info.allocator_overhead = info.heap_nodes * (mallocChunkSize(sizeof(avl_node)) - sizeof(avl_node));
+        if (!shared)
+            info.unused_block_bytes = (node_block_size_ - pooled) * sizeof(node_storage);
+        return info;
+    }
+
+    // Relocates every node into one contiguous block, laid out in the given order.
+    // Links, heights and subtree sizes are preserved; iterators are invalidated.
+    void compact(CompactOrder order = CompactOrder::in_order) {
+        size_t count = size();
+        if (!count) {
+            node_block_.reset();
+            node_block_size_ = 0;
             return;
         }
 
+        std::shared_ptr<node_storage[]> block(new node_storage[count]);
+
+        struct relocation {
+            avl_node* old_node;
+            avl_node* new_parent;
+            bool is_left;
+            size_t offset; // in-order index of the leftmost key of the subtree
+        };
+
+        std::vector<relocation> work = {{root.get(), nullptr, false, 0}};
+        size_t head = 0;
+        size_t next_slot = 0;
+        node_ptr new_root = nullptr;
+
+        while (head < work.size()) {
+            relocation current;
+            if (order == CompactOrder::breadth_first) {
+                current = work[head++];
+            }
+            else {
+                current = work.back();
+                work.pop_back();
+            }
+
+            avl_node* old_node = current.old_node;
+            size_t left_size = old_node->left_ ? old_node->left_->getSubtreeSize() : 0;
+            size_t slot = order == CompactOrder::breadth_first ? next_slot++ : current.offset + left_size;
+
+            avl_node* node = new (block[slot].bytes) avl_node(std::move(old_node->key_), old_node->height_,
+                                                              old_node->subtree_size_, current.new_parent);
+            node->augment_ = std::move(old_node->augment_);
+            node->pooled_ = true;
+
+            if (!current.new_parent)
+                new_root.reset(node);
+            else if (current.is_left)
+                current.new_parent->left_.reset(node);
+            else
+                current.new_parent->right_.reset(node);
+
+            if (old_node->left_)
+                work.push_back({old_node->left_.get(), node, true, current.offset});
+            if (old_node->right_)
+                work.push_back({old_node->right_.get(), node, false, current.offset + left_size + 1});
+        }
+
+        root = std::move(new_root); // old nodes are destroyed before their block is released
+        node_block_ = std::move(block);
+        node_block_size_ = count;
+    }
+
+ private:
+    static constexpr size_t mallocChunkSize(size_t bytes) noexcept { // glibc-like: 8 byte header, 16 byte granule
+        size_t chunk = (bytes + sizeof(size_t) + 15) & ~size_t{15};
+        return std::max<size_t>(chunk, 32);
+    }
+
+ public:
+    bool insert(const KeyType& key_to_insert) {
+        if (!root) {
+            root = makeNode(key_to_insert);
+            BalancePolicy::initNode(*root);
+            Augment::update(*root);
+            BalancePolicy::fixInsert(*this, root.get());
+            return true;
+        }
+
         auto [parent, where_to_insert] = find(key_to_insert);
         if (where_to_insert == find_flag::exists)
-            return;
+            return false;
 
-        auto new_node = std::make_unique<avl_node>(key_to_insert);
+        auto new_node = makeNode(key_to_insert);
         new_node->parent_ = parent;
+        BalancePolicy::initNode(*new_node);
+        Augment::update(*new_node);
+        avl_node* inserted = new_node.get();
 
         if (where_to_insert == find_flag::right)
             parent->right_ = std::move(new_node);
         else if (where_to_insert == find_flag::left)
             parent->left_ = std::move(new_node);
 
-        updateHeights(parent);
+        updateSizes(parent);
+        BalancePolicy::fixInsert(*this, inserted);
+        return true;
     }
 
     find_res find(const KeyType& key_to_find) const {
@@ -319,9 +578,9 @@ class avl_tree final {
     }
 
  private:
-    std::unique_ptr<avl_node> rotateLeft(std::unique_ptr<avl_node> disbalancedNode) {
-        std::unique_ptr<avl_node> newRoot;
-        std::unique_ptr<avl_node> newSubtree;
+    node_ptr rotateLeft(node_ptr disbalancedNode) {
+        node_ptr newRoot;
+        node_ptr newSubtree;
 
         newRoot = std::move(disbalancedNode->right_);
         newSubtree = std::move(newRoot->left_);
@@ -334,18 +593,18 @@ class avl_tree final {
             newSubtree->parent_ = newRoot->left_.get();
         newRoot->left_->right_ = std::move(newSubtree);
 
-        newRoot->left_->updateNodeHeight();
+        BalancePolicy::updateNode(*newRoot->left_);
         newRoot->left_->updateSubtreeSize();
 
-        newRoot->updateNodeHeight();
+        BalancePolicy::updateNode(*newRoot);
         newRoot->updateSubtreeSize();
 
         return newRoot;
     }
 
-    std::unique_ptr<avl_node> rotateRight(std::unique_ptr<avl_node> disbalancedNode) {
-        std::unique_ptr<avl_node> newRoot;
-        std::unique_ptr<avl_node> newSubtree;
+    node_ptr rotateRight(node_ptr disbalancedNode) {
+        node_ptr newRoot;
+        node_ptr newSubtree;
 
         newRoot = std::move(disbalancedNode->left_);
         newSubtree = std::move(newRoot->right_);
@@ -358,67 +617,163 @@ class avl_tree final {
             newSubtree->parent_ = newRoot->right_.get();
         newRoot->right_->left_ = std::move(newSubtree);
 
-        newRoot->right_->updateNodeHeight();
+        BalancePolicy::updateNode(*newRoot->right_);
         newRoot->right_->updateSubtreeSize();
 
-        newRoot->updateNodeHeight();
+        BalancePolicy::updateNode(*newRoot);
         newRoot->updateSubtreeSize();
 
         return newRoot;
     }
 
-    std::unique_ptr<avl_node> rebalance(std::unique_ptr<avl_node> disbalancedNode) {
-        int balanceFactor = disbalancedNode->getBalanceFactor();
-        if (MIN_BALANCE <= balanceFactor && balanceFactor <= MAX_BALANCE)
-            return disbalancedNode;
+    node_ptr& owner(avl_node* node) {
+        if (!node->parent_)
+            return root;
+
+        avl_node* parent = node->parent_;
+        return parent->left_.get() == node ? parent->left_ : parent->right_;
+    }
 
-        std::unique_ptr<avl_node> newRoot = nullptr;
+    void rotate(avl_node* node, rotate_direction direction) {
+        node_ptr& slot = owner(node);
 
-        if (balanceFactor > MAX_BALANCE) { // left disbalancedNode
-            if (disbalancedNode->left_->getBalanceFactor() < 0) {
-                disbalancedNode->left_ = rotateLeft(std::move(disbalancedNode->left_));
-                disbalancedNode->left_->parent_ = disbalancedNode.get();
-            }
+        if (direction == rotate_direction::left)
+            slot = rotateLeft(std::move(slot));
+        else
+            slot = rotateRight(std::move(slot));
+    }
 
-            newRoot = rotateRight(std::move(disbalancedNode));
+    void updateSizes(avl_node* node) noexcept {
+        while (node) {
+            ++node->subtree_size_;
+            Augment::update(*node);
+            node = node->parent_;
         }
-        else {                             // right disbalancedNode
-            if (disbalancedNode->right_->getBalanceFactor() > 0) {
-                disbalancedNode->right_ = rotateRight(std::move(disbalancedNode->right_));
-                disbalancedNode->right_->parent_ = disbalancedNode.get();
-            }
-            newRoot = rotateLeft(std::move(disbalancedNode));
+    }
+
+ public:
+    // Builds a balanced tree from strictly increasing keys in O(n), without comparisons or rotations.
+    static avl_tree build_from_sorted(std::span<const KeyType> keys) {
+        assert(std::adjacent_find(keys.begin(), keys.end(),
+                                  [](const KeyType& a, const KeyType& b) { return !(a < b); }) == keys.end());
+
+        avl_tree result;
+        size_t full_depth = static_cast<size_t>(std::bit_width(keys.size() + 1)) - 1;
+        result.root = buildSorted(keys, nullptr, 0, full_depth);
+        return result;
+    }
+
+    // Moves every key less than `key` into the returned tree in O(log n) (split by AVL joins).
+    // Nodes placed by compact() keep sharing this tree's block with the returned tree; while both
+    // hold it, memory_usage() reports it as shared_block_bytes rather than block_bytes.
+    avl_tree split_before(const KeyType& key) requires std::same_as<BalancePolicy, avl_balance> {
+        auto [less, rest] = split(std::move(root), key);
+        root = std::move(rest);
+
+        avl_tree result;
+        result.root = std::move(less);
+        if (result.root) {
+            result.node_block_ = node_block_;
+            result.node_block_size_ = node_block_size_;
         }
+        return result;
+    }
 
-        return newRoot;
+ private:
+    // median split: subtree sizes differ by at most one, so only the last level is incomplete
+    static node_ptr buildSorted(std::span<const KeyType> keys, avl_node* parent, size_t depth, size_t full_depth) {
+        if (keys.empty())
+            return nullptr;
+
+        size_t middle = keys.size() / 2;
+        size_t height = static_cast<size_t>(std::bit_width(keys.size()));
+
+        node_ptr node = makeNode(keys[middle], height, keys.size(), parent);
+        BalancePolicy::initBuilt(*node, height, depth, full_depth);
+        node->left_  = buildSorted(keys.first(middle), node.get(), depth + 1, full_depth);
+        node->right_ = buildSorted(keys.subspan(middle + 1), node.get(), depth + 1, full_depth);
+        Augment::update(*node);
+        return node;
     }
 
-    void updateHeights(avl_node* node) {
-        while (node) {
-            node->updateNodeHeight();
-            node->updateSubtreeSize();
+    static size_t heightOf(const node_ptr& node) noexcept {
+        return node ? node->getHeight() : 0;
+    }
 
-            int balanceFactor = node->getBalanceFactor();
+    static node_ptr detach(node_ptr& child) noexcept {
+        if (child)
+            child->parent_ = nullptr;
+        return std::move(child);
+    }
 
-            if (balanceFactor < MIN_BALANCE || balanceFactor > MAX_BALANCE) {
-                avl_node* parent = node->parent_;
+    static node_ptr attach(node_ptr left, node_ptr middle, node_ptr right) {
+        if (left)
+            left->parent_ = middle.get();
+        if (right)
+            right->parent_ = middle.get();
+
+        middle->left_  = std::move(left);
+        middle->right_ = std::move(right);
+        middle->updateNodeHeight();
+        middle->updateSubtreeSize();
+        return middle;
+    }
 
-                if (parent) {
-                    if (parent->left_.get() == node)
-                        parent->left_ = rebalance(std::move(parent->left_));
-                    else
-                        parent->right_ = rebalance(std::move(parent->right_));
-                }
-                else {
-                    root = rebalance(std::move(root));
-                }
+    node_ptr rebalanceSubtree(node_ptr node) {
+        node->updateNodeHeight();
+        node->updateSubtreeSize();
 
-                node = parent;
-            }
-            else {
-                node = node->parent_;
-            }
+        int balanceFactor = node->getBalanceFactor();
+        if (balanceFactor > MAX_BALANCE) {
+            if (node->left_->getBalanceFactor() < 0)
+                node->left_ = rotateLeft(std::move(node->left_));
+            return rotateRight(std::move(node));
+        }
+        if (balanceFactor < MIN_BALANCE) {
+            if (node->right_->getBalanceFactor() > 0)
+                node->right_ = rotateRight(std::move(node->right_));
+            return rotateLeft(std::move(node));
+        }
+        return node;
+    }
+
+    // All keys of `left` < middle->key_ < all keys of `right`; the subtrees are detached.
+    node_ptr join(node_ptr left, node_ptr middle, node_ptr right) {
+        size_t left_height  = heightOf(left);
+        size_t right_height = heightOf(right);
+
+        if (left_height > right_height + 1) {
+            node_ptr inner = detach(left->right_);
+            left->right_ = join(std::move(inner), std::move(middle), std::move(right));
+            left->right_->parent_ = left.get();
+            return rebalanceSubtree(std::move(left));
+        }
+
+        if (right_height > left_height + 1) {
+            node_ptr inner = detach(right->left_);
+            right->left_ = join(std::move(left), std::move(middle), std::move(inner));
+            right->left_->parent_ = right.get();
+            return rebalanceSubtree(std::move(right));
+        }
+
+        return attach(std::move(left), std::move(middle), std::move(right));
+    }
+
+    std::pair<node_ptr, node_ptr> split(node_ptr node, const KeyType& key) {
+        if (!node)
+            return {nullptr, nullptr};
+
+        node->parent_ = nullptr;
+        node_ptr left  = detach(node->left_);
+        node_ptr right = detach(node->right_);
+
+        if (node->key_ < key) {
+            auto [less, rest] = split(std::move(right), key);
+            return {join(std::move(left), std::move(node), std::move(less)), std::move(rest)};
         }
+
+        auto [less, rest] = split(std::move(left), key);
+        return {std::move(less), join(std::move(rest), std::move(node), std::move(right))};
     }
 
  public:
@@ -477,9 +832,127 @@ class avl_tree final {
         if (first > second)
             return 0;
 
+        return countBetween(lower_bound(first), upper_bound(second));
+    }
+
+    // number of keys less than `key`, one descent
+    size_t count_less(const KeyType& key) const noexcept {
+        return countBefore<false>(key);
+    }
+
+    // number of keys not greater than `key`
+    size_t count_less_equal(const KeyType& key) const noexcept {
+        return countBefore<true>(key);
+    }
+
+    range_view range(const KeyType& first, const KeyType& second) const {
+        if (first > second)
+            return range_view();
+
         iterator lower = lower_bound(first);
         iterator upper = upper_bound(second);
+        size_t count = countBetween(lower, upper);
+
+        if (!count)
+            return range_view();
+
+        return range_view(key_iterator(lower.node_), key_iterator(upper.node_), count);
+    }
+
+    // Writes the keys in [first, second] to `out` in ascending order with a stack-based in-order walk.
+    template <typename OutputIt>
+    OutputIt copy_range(const KeyType& first, const KeyType& second, OutputIt out) const {
+        auto emit = [&out](const KeyType& key) { *out++ = key; };
+        walkRange(first, second, emit);
+        return out;
+    }
+
+    void copy_range(const KeyType& first, const KeyType& second, std::vector<KeyType>& out) const {
+        out.reserve(out.size() + range_queries(first, second));
+        copy_range(first, second, std::back_inserter(out));
+    }
+
+    // Calls function(key) for every key in [first, second]. With threads > 1 the range is cut into
+    // subtrees of similar size and `function` is called concurrently, in order within each part.
+    template <typename Function>
+    void for_each_in_range(const KeyType& first, const KeyType& second, Function function,
+                           size_t threads = 1) const {
+        if (threads <= 1) {
+            walkRange(first, second, function);
+            return;
+        }
+
+        parallel_for_each(first, second, function, threads);
+    }
+
+    // Parallel algorithms. The keys are cut by subtree_size_ into about 8 pieces per thread,
+    // which the threads take from a shared counter; functions are called concurrently.
+    template <typename Function>
+    void parallel_for_each(Function function, size_t threads = defaultThreads()) const {
+        auto pieces = splitAll(threads);
+        runPieces(pieces, threads, [&function](const range_piece& piece, size_t) {
+            piece.for_each(function);
+        });
+    }
+
+    template <typename Function>
+    void parallel_for_each(const KeyType& first, const KeyType& second, Function function,
+                           size_t threads = defaultThreads()) const {
+        auto pieces = splitBetween(first, second, threads);
+        runPieces(pieces, threads, [&function](const range_piece& piece, size_t) {
+            piece.for_each(function);
+        });
+    }
+
+    // reduce(... reduce(reduce(init, map(k0)), map(k1)) ...) over keys in ascending order;
+    // `reduce` must be associative and `init` its identity.
+    template <typename ValueType, typename Map, typename Reduce>
+    ValueType parallel_reduce(ValueType init, Map map, Reduce reduce, size_t threads = defaultThreads()) const {
+        auto pieces = splitAll(threads);
+        return reducePieces(pieces, init, map, reduce, threads);
+    }
 
+    template <typename ValueType, typename Map, typename Reduce>
+    ValueType parallel_reduce(const KeyType& first, const KeyType& second, ValueType init, Map map,
+                              Reduce reduce, size_t threads = defaultThreads()) const {
+        auto pieces = splitBetween(first, second, threads);
+        return reducePieces(pieces, init, map, reduce, threads);
+    }
+
+    template <typename Predicate>
+    size_t parallel_count_if(Predicate predicate, size_t threads = defaultThreads()) const {
+        return parallel_reduce(size_t{0}, [&predicate](const KeyType& key) -> size_t { return predicate(key) ? 1 : 0; },
+                               std::plus<size_t>(), threads);
+    }
+
+    template <typename Predicate>
+    size_t parallel_count_if(const KeyType& first, const KeyType& second, Predicate predicate,
+                             size_t threads = defaultThreads()) const {
+        return parallel_reduce(first, second, size_t{0},
+                               [&predicate](const KeyType& key) -> size_t { return predicate(key) ? 1 : 0; },
+                               std::plus<size_t>(), threads);
+    }
+
+ private:
+    template <bool Inclusive>
+    size_t countBefore(const KeyType& key) const noexcept {
+        size_t result = 0;
+        const avl_node* node = root.get();
+
+        while (node) {
+            bool before = Inclusive ? !(key < node->key_) : node->key_ < key;
+            if (before) {
+                result += 1 + (node->left_ ? node->left_->getSubtreeSize() : 0);
+                node = node->right_.get();
+            }
+            else {
+                node = node->left_.get();
+            }
+        }
+        return result;
+    }
+
+    size_t countBetween(iterator lower, iterator upper) const {
         if (!lower)
             return 0;
         if (!upper)
@@ -487,6 +960,242 @@ class avl_tree final {
 
         return distance(lower, upper);
     }
+
+    template <typename Function>
+    void walkRange(const KeyType& first, const KeyType& second, Function& function) const {
+        if (first > second)
+            return;
+
+        std::vector<const avl_node*> stack;
+        const avl_node* node = root.get();
+
+        while (node || !stack.empty()) {
+            while (node) {
+                if (node->key_ < first) {
+                    node = node->right_.get();
+                }
+                else {
+                    stack.push_back(node);
+                    node = node->left_.get();
+                }
+            }
+
+            node = stack.back();
+            stack.pop_back();
+
+            if (node->key_ > second)
+                return;
+
+            function(node->key_);
+            node = node->right_.get();
+        }
+    }
+
+    // Either a single key or a whole subtree, all inside the requested range.
+    struct range_piece {
+        const avl_node* node;
+        bool whole_subtree;
+
+        size_t size() const noexcept {
+            return whole_subtree ? node->getSubtreeSize() : 1;
+        }
+
+        template <typename Function>
+        void for_each(Function& function) const {
+            if (!whole_subtree) {
+                function(node->key_);
+                return;
+            }
+
+            std::vector<const avl_node*> stack;
+            const avl_node* current = node;
+
+            while (current || !stack.empty()) {
+                while (current) {
+                    stack.push_back(current);
+                    current = current->left_.get();
+                }
+
+                current = stack.back();
+                stack.pop_back();
+                function(current->key_);
+                current = current->right_.get();
+            }
+        }
+    };
+
+    static size_t defaultThreads() noexcept {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::vector<range_piece> splitAll(size_t threads) const {
+        std::vector<range_piece> pieces;
+        if (root)
+            splitRange(root.get(), root->key_, root->key_, grainFor(size(), threads), false, false, pieces);
+        return pieces;
+    }
+
+    std::vector<range_piece> splitBetween(const KeyType& first, const KeyType& second, size_t threads) const {
+        std::vector<range_piece> pieces;
+        size_t total = range_queries(first, second);
+        if (total)
+            splitRange(root.get(), first, second, grainFor(total, threads), true, true, pieces);
+        return pieces;
+    }
+
+    static size_t grainFor(size_t total, size_t threads) noexcept {
+        return std::max<size_t>(1, total / (std::max<size_t>(threads, 1) * 8));
+    }
+
+    // Calls piece_function(piece, index) for every piece; threads pull pieces from a shared counter.
+    template <typename PieceFunction>
+    static void runPieces(const std::vector<range_piece>& pieces, size_t threads, PieceFunction piece_function) {
+        std::atomic<size_t> next = 0;
+        auto worker = [&] {
+            for (size_t index = next++; index < pieces.size(); index = next++)
+                piece_function(pieces[index], index);
+        };
+
+        threads = std::clamp<size_t>(threads, 1, std::max<size_t>(pieces.size(), 1));
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < threads; ++i)
+            workers.emplace_back(worker);
+
+        worker();
+        for (auto& thread : workers)
+            thread.join();
+    }
+
+    template <typename ValueType, typename Map, typename Reduce>
+    static ValueType reducePieces(const std::vector<range_piece>& pieces, const ValueType& init, Map& map,
+                                  Reduce& reduce, size_t threads) {
+        std::vector<ValueType> partial(pieces.size(), init);
+        runPieces(pieces, threads, [&](const range_piece& piece, size_t index) {
+            ValueType accumulator = init;
+            auto accumulate = [&](const KeyType& key) { accumulator = reduce(std::move(accumulator), map(key)); };
+            piece.for_each(accumulate);
+            partial[index] = std::move(accumulator);
+        });
+
+        ValueType result = init;
+        for (auto& value : partial)
+            result = reduce(std::move(result), std::move(value));
+        return result;
+    }
+
+    // Cuts [first, second] into in-order pieces of at most `grain` keys each (single keys aside).
+    void splitRange(const avl_node* node, const KeyType& first, const KeyType& second, size_t grain,
+                    bool checkLow, bool checkHigh, std::vector<range_piece>& pieces) const {
+        if (!node)
+            return;
+
+        if (!checkLow && !checkHigh && node->getSubtreeSize() <= grain) {
+            pieces.push_back({node, true});
+            return;
+        }
+
+        if (checkLow && node->key_ < first) {
+            splitRange(node->right_.get(), first, second, grain, checkLow, checkHigh, pieces);
+            return;
+        }
+
+        if (checkHigh && node->key_ > second) {
+            splitRange(node->left_.get(), first, second, grain, checkLow, checkHigh, pieces);
+            return;
+        }
+
+        splitRange(node->left_.get(), first, second, grain, checkLow, false, pieces);
+        pieces.push_back({node, false});
+        splitRange(node->right_.get(), first, second, grain, false, checkHigh, pieces);
+    }
+
+ public:
+
+    // Batched point lookups. Up to `group` descents run interleaved (AMAC): each step prefetches
+    // the next child and switches to another lookup, so cache misses of different keys overlap.
+    void find_batch(std::span<const KeyType> keys, std::span<iterator> result,
+                    size_t group = DEFAULT_LOOKUP_GROUP) const {
+        assert(result.size() >= keys.size());
+
+        descendBatch(keys, group, [&](size_t index, avl_node* candidate, size_t) {
+            bool found = candidate && !(keys[index] < candidate->key_);
+            result[index] = avl_iterator(found ? candidate : nullptr);
+        });
+    }
+
+    void lower_bound_batch(std::span<const KeyType> keys, std::span<iterator> result,
+                           size_t group = DEFAULT_LOOKUP_GROUP) const {
+        assert(result.size() >= keys.size());
+
+        descendBatch(keys, group, [&](size_t index, avl_node* candidate, size_t) {
+            result[index] = avl_iterator(candidate);
+        });
+    }
+
+    // result[i] = number of keys less than keys[i]
+    void rank_batch(std::span<const KeyType> keys, std::span<size_t> result,
+                    size_t group = DEFAULT_LOOKUP_GROUP) const {
+        assert(result.size() >= keys.size());
+
+        descendBatch(keys, group, [&](size_t index, avl_node*, size_t rank) {
+            result[index] = rank;
+        });
+    }
+
+ private:
+    template <typename Finish>
+    void descendBatch(std::span<const KeyType> keys, size_t group, Finish finish) const {
+        struct lookup {
+            avl_node* node;
+            avl_node* candidate; // smallest visited key >= target
+            size_t rank;
+            size_t index;
+        };
+
+        std::array<lookup, MAX_LOOKUP_GROUP> lookups;
+        group = std::clamp<size_t>(group, 1, MAX_LOOKUP_GROUP);
+
+        size_t next = 0;
+        size_t active = 0;
+        while (active < group && next < keys.size()) {
+            lookups[active++] = {root.get(), nullptr, 0, next};
+            ++next;
+        }
+
+        while (active) {
+            for (size_t i = 0; i < active;) {
+                lookup& current = lookups[i];
+
+                if (current.node) {
+                    avl_node* node = current.node;
+                    if (!(node->key_ < keys[current.index])) {
+                        current.candidate = node;
+                        current.node = node->left_.get();
+                    }
+                    else {
+                        current.rank += 1 + (node->left_ ? node->left_->getSubtreeSize() : 0);
+                        current.node = node->right_.get();
+                    }
+
+                    if (current.node)
+                        __builtin_prefetch(current.node);
+                    ++i;
+                    continue;
+                }
+
+                finish(current.index, current.candidate, current.rank);
+
+                if (next < keys.size()) {
+                    current = {root.get(), nullptr, 0, next};
+                    ++next;
+                    ++i;
+                }
+                else {
+                    current = lookups[--active];
+                }
+            }
+        }
+    }
 };
 
 template <typename Iterator>
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace avl {
+
+static constexpr int MIN_BALANCE = -1;
+static constexpr int MAX_BALANCE =  1;
+
+enum class RotationDirection {
+    left,
+    right
+};
+
+// Every policy reinterprets avl_node::height_ as its own per-node balance data:
+//   avl_balance   - subtree height (leaf = 1)
+//   wavl_balance  - rank + 1 (leaf = 1, missing child = 0)
+//   rb_balance    - colour (red = 1, black = 0)
+//   treap_balance - heap priority
+// Rotations, subtree sizes and iterators are shared by the tree itself.
+// initBuilt() sets the data of a node placed by avl_tree::build_from_sorted(): `height` is its
+// subtree height, `depth` its distance from the root and every level above `full_depth` is full.
+
+struct avl_balance final {
+    template <typename Node>
+    static void initNode(Node&) noexcept {}
+
+    template <typename Node>
+    static void initBuilt(Node& node, size_t height, size_t, size_t) noexcept {
+        node.height_ = height;
+    }
+
+    template <typename Node>
+    static void updateNode(Node& node) noexcept {
+        node.updateNodeHeight();
+    }
+
+    template <typename Tree, typename Node>
+    static void fixInsert(Tree& tree, Node* node) {
+        Node* current = node->parent_;
+
+        while (current) {
+            size_t old_height = current->height_;
+            current->updateNodeHeight();
+
+            int balanceFactor = current->getBalanceFactor();
+            if (balanceFactor < MIN_BALANCE || balanceFactor > MAX_BALANCE) {
+                rebalance(tree, current, balanceFactor);
+                return; // one (double) rotation restores the pre-insert height
+            }
+
+            if (current->height_ == old_height)
+                return;
+
+            current = current->parent_;
+        }
+    }
+
+ private:
+    template <typename Tree, typename Node>
+    static void rebalance(Tree& tree, Node* disbalancedNode, int balanceFactor) {
+        if (balanceFactor > MAX_BALANCE) { // left disbalancedNode
+            if (disbalancedNode->left_->getBalanceFactor() < 0)
+                tree.rotate(disbalancedNode->left_.get(), RotationDirection::left);
+
+            tree.rotate(disbalancedNode, RotationDirection::right);
+        }
+        else {                             // right disbalancedNode
+            if (disbalancedNode->right_->getBalanceFactor() > 0)
+                tree.rotate(disbalancedNode->right_.get(), RotationDirection::right);
+
+            tree.rotate(disbalancedNode, RotationDirection::left);
+        }
+    }
+};
+
+// Weak AVL (Haeupler, Sen, Tarjan): every rank difference is 1 or 2 and leaves are 1,1.
+// Insertion does at most two rotations, and promotions are O(1) amortised.
+struct wavl_balance final {
+    template <typename Node>
+    static void initNode(Node&) noexcept {}
+
+    // rank = height keeps every rank difference at 1 or 2
+    template <typename Node>
+    static void initBuilt(Node& node, size_t height, size_t, size_t) noexcept {
+        node.height_ = height;
+    }
+
+    template <typename Node>
+    static void updateNode(Node&) noexcept {}
+
+    template <typename Tree, typename Node>
+    static void fixInsert(Tree& tree, Node* node) {
+        Node* parent = node->parent_;
+
+        while (parent && parent->height_ == node->height_) {
+            bool isLeft = parent->left_.get() == node;
+            Node* sibling = isLeft ? parent->right_.get() : parent->left_.get();
+
+            if (parent->height_ - rank(sibling) == 1) {
+                ++parent->height_;
+                node = parent;
+                parent = node->parent_;
+                continue;
+            }
+
+            Node* inner = isLeft ? node->right_.get() : node->left_.get();
+            auto outward = isLeft ? RotationDirection::right : RotationDirection::left;
+            auto inward  = isLeft ? RotationDirection::left  : RotationDirection::right;
+
+            if (node->height_ - rank(inner) == 2) {
+                tree.rotate(parent, outward);
+                --parent->height_;
+            }
+            else {
+                tree.rotate(node, inward);
+                tree.rotate(parent, outward);
+                ++inner->height_;
+                --node->height_;
+                --parent->height_;
+            }
+            return;
+        }
+    }
+
+ private:
+    template <typename Node>
+    static size_t rank(const Node* node) noexcept {
+        return node ? node->height_ : 0;
+    }
+};
+
+struct rb_balance final {
+    static constexpr size_t black = 0;
+    static constexpr size_t red   = 1;
+
+    template <typename Node>
+    static void initNode(Node& node) noexcept {
+        node.height_ = red;
+    }
+
+    // only the last, incomplete level is red: every root-to-leaf path has the same black count
+    template <typename Node>
+    static void initBuilt(Node& node, size_t, size_t depth, size_t full_depth) noexcept {
+        node.height_ = depth >= full_depth ? red : black;
+    }
+
+    template <typename Node>
+    static void updateNode(Node&) noexcept {}
+
+    template <typename Tree, typename Node>
+    static void fixInsert(Tree& tree, Node* node) {
+        while (isRed(node->parent_)) {
+            Node* parent = node->parent_;
+            Node* grand  = parent->parent_; // a red parent is never the root
+
+            bool parentIsLeft = grand->left_.get() == parent;
+            Node* uncle = parentIsLeft ? grand->right_.get() : grand->left_.get();
+
+            if (isRed(uncle)) {
+                parent->height_ = black;
+                uncle->height_  = black;
+                grand->height_  = red;
+                node = grand;
+                continue;
+            }
+
+            auto outward = parentIsLeft ? RotationDirection::right : RotationDirection::left;
+            auto inward  = parentIsLeft ? RotationDirection::left  : RotationDirection::right;
+
+            Node* inner = parentIsLeft ? parent->right_.get() : parent->left_.get();
+            if (node == inner) {
+                tree.rotate(parent, inward);
+                node = parent;
+                parent = node->parent_;
+            }
+
+            parent->height_ = black;
+            grand->height_  = red;
+            tree.rotate(grand, outward);
+        }
+
+        tree.root->height_ = black;
+    }
+
+ private:
+    template <typename Node>
+    static bool isRed(const Node* node) noexcept {
+        return node && node->height_ == red;
+    }
+};
+
+// Randomized treap: max-heap on priorities, expected O(log n) depth.
+struct treap_balance final {
+    template <typename Node>
+    static void initNode(Node& node) noexcept {
+        node.height_ = static_cast<size_t>(nextPriority());
+    }
+
+    // the subtree height in the top bits keeps the heap order, the low bits stay random
+    template <typename Node>
+    static void initBuilt(Node& node, size_t height, size_t, size_t) noexcept {
+        node.height_ = static_cast<size_t>((uint64_t{height} << 57) | (nextPriority() >> 7));
+    }
+
+    template <typename Node>
+    static void updateNode(Node&) noexcept {}
+
+    template <typename Tree, typename Node>
+    static void fixInsert(Tree& tree, Node* node) {
+        while (node->parent_ && node->parent_->height_ < node->height_) {
+            Node* parent = node->parent_;
+            tree.rotate(parent, parent->left_.get() == node ? RotationDirection::right
+                                                            : RotationDirection::left);
+        }
+    }
+
+ private:
+    static uint64_t nextPriority() noexcept { // splitmix64
+        thread_local uint64_t state = 0x9E3779B97F4A7C15ull;
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+};
+
+} // namespace avl
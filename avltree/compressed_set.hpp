@@ -0,0 +1,315 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace avl {
+
+// Sorted run of integers stored frame-of-reference encoded: the smallest key plus
+// fixed-width bit-packed offsets from it. Offsets stay randomly accessible, so
+// searches binary-search the packed words without decoding the block.
+template <std::integral IntType>
+class packed_block final {
+    using UnsignedType = std::make_unsigned_t<IntType>;
+
+ private:
+    IntType base_ = 0;
+    uint32_t size_ = 0;
+    uint8_t width_ = 0;
+    std::vector<uint64_t> words_;
+
+ public:
+    size_t size() const noexcept {
+        return size_;
+    }
+
+    IntType front() const noexcept {
+        return base_;
+    }
+
+    IntType get(size_t index) const noexcept {
+        if (width_ == 0)
+            return base_;
+
+        size_t bit   = index * width_;
+        size_t word  = bit / 64;
+        size_t shift = bit % 64;
+
+        uint64_t value = words_[word] >> shift;
+        if (shift + width_ > 64)
+            value |= words_[word + 1] << (64 - shift);
+        if (width_ < 64)
+            value &= (uint64_t{1} << width_) - 1;
+
+        return static_cast<IntType>(static_cast<UnsignedType>(base_) + static_cast<UnsignedType>(value));
+    }
+
+    // number of keys less than `key`
+    size_t lowerBound(IntType key) const noexcept {
+        return partition([key](IntType value) { return value < key; });
+    }
+
+    // number of keys not greater than `key`
+    size_t upperBound(IntType key) const noexcept {
+        return partition([key](IntType value) { return !(key < value); });
+    }
+
+    void decode(std::vector<IntType>& keys) const {
+        keys.resize(size_);
+        for (size_t i = 0; i < size_; ++i)
+            keys[i] = get(i);
+    }
+
+    void encode(const IntType* keys, size_t count) {
+        base_ = count ? keys[0] : 0;
+        size_ = static_cast<uint32_t>(count);
+
+        uint64_t max_offset = count ? offset(keys[count - 1]) : 0;
+        width_ = static_cast<uint8_t>(std::bit_width(max_offset));
+
+        std::vector<uint64_t> words((count * width_ + 63) / 64, 0);
+        for (size_t i = 0; i < count && width_; ++i) {
+            uint64_t value = offset(keys[i]);
+            size_t bit   = i * width_;
+            size_t word  = bit / 64;
+            size_t shift = bit % 64;
+
+            words[word] |= value << shift;
+            if (shift + width_ > 64)
+                words[word + 1] |= value >> (64 - shift);
+        }
+        words_.swap(words);
+    }
+
+    size_t bytes() const noexcept {
+        return sizeof(*this) + words_.capacity() * sizeof(uint64_t);
+    }
+
+ private:
+    uint64_t offset(IntType key) const noexcept {
+        return static_cast<uint64_t>(static_cast<UnsignedType>(static_cast<UnsignedType>(key) -
+                                                               static_cast<UnsignedType>(base_)));
+    }
+
+    template <typename Predicate>
+    size_t partition(Predicate predicate) const noexcept {
+        size_t low = 0;
+        size_t high = size_;
+        while (low < high) {
+            size_t middle = low + (high - low) / 2;
+            if (predicate(get(middle)))
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        return low;
+    }
+};
+
+// Ordered set of integers for large, clustered key sets. Keys live in packed_block leaves
+// of at most BLOCK_CAPACITY keys; a B+ tree of leaves keeps per-child key counts, so
+// range_queries() sums whole blocks from the counts and only searches the two boundary leaves.
+template <std::integral IntType>
+class compressed_set final {
+ public:
+    static constexpr size_t BLOCK_CAPACITY = 256;
+    static constexpr size_t FANOUT = 64;
+
+ private:
+    struct node;
+
+    struct branch {
+        std::vector<IntType> firsts;            // smallest key of every child
+        std::vector<size_t> counts;             // keys in every child
+        std::vector<std::unique_ptr<node>> children;
+    };
+
+    // Leaves carry only the packed block; inner nodes keep their children in a separate branch.
+    struct node {
+        packed_block<IntType> block;
+        std::unique_ptr<branch> inner = nullptr;
+
+        bool leaf() const noexcept {
+            return !inner;
+        }
+
+        size_t size() const noexcept {
+            if (leaf())
+                return block.size();
+
+            size_t total = 0;
+            for (size_t count : inner->counts)
+                total += count;
+            return total;
+        }
+
+        IntType front() const noexcept {
+            return leaf() ? block.front() : inner->firsts.front();
+        }
+
+        size_t childIndex(IntType key) const noexcept {
+            const auto& firsts = inner->firsts;
+            size_t index = static_cast<size_t>(std::upper_bound(firsts.begin(), firsts.end(), key) - firsts.begin());
+            return index ? index - 1 : 0;
+        }
+    };
+
+    std::unique_ptr<node> root_ = nullptr;
+    size_t size_ = 0;
+    std::vector<IntType> scratch_;
+
+ public:
+    bool insert(IntType key) {
+        if (!root_)
+            root_ = std::make_unique<node>();
+
+        bool inserted = false;
+        auto sibling = insertInto(*root_, key, inserted);
+
+        if (sibling) {
+            auto new_root = std::make_unique<node>();
+            new_root->inner = std::make_unique<branch>();
+            new_root->inner->firsts = {root_->front(), sibling->front()};
+            new_root->inner->counts = {root_->size(), sibling->size()};
+            new_root->inner->children.push_back(std::move(root_));
+            new_root->inner->children.push_back(std::move(sibling));
+            root_ = std::move(new_root);
+        }
+
+        size_ += inserted;
+        return inserted;
+    }
+
+    bool contains(IntType key) const noexcept {
+        return countLessEqual(key) != countLess(key);
+    }
+
+    size_t range_queries(IntType first, IntType second) const noexcept {
+        if (first > second)
+            return 0;
+
+        return countLessEqual(second) - countLess(first);
+    }
+
+    size_t size() const noexcept {
+        return size_;
+    }
+
+    // bytes held by leaves and inner nodes, including vector headers
+    size_t memory_usage() const noexcept {
+        if (!root_)
+            return sizeof(*this);
+
+        size_t bytes = sizeof(*this);
+        std::vector<const node*> stack = {root_.get()};
+
+        while (!stack.empty()) {
+            const node* current = stack.back();
+            stack.pop_back();
+
+            bytes += sizeof(node) - sizeof(current->block) + current->block.bytes();
+            if (current->leaf())
+                continue;
+
+            const branch& inner = *current->inner;
+            bytes += sizeof(branch);
+            bytes += inner.firsts.capacity() * sizeof(IntType);
+            bytes += inner.counts.capacity() * sizeof(size_t);
+            bytes += inner.children.capacity() * sizeof(std::unique_ptr<node>);
+
+            for (const auto& child : inner.children)
+                stack.push_back(child.get());
+        }
+
+        return bytes;
+    }
+
+ private:
+    std::unique_ptr<node> insertInto(node& current, IntType key, bool& inserted) {
+        if (current.leaf()) {
+            current.block.decode(scratch_);
+            auto position = std::lower_bound(scratch_.begin(), scratch_.end(), key);
+            if (position != scratch_.end() && *position == key)
+                return nullptr;
+
+            scratch_.insert(position, key);
+            inserted = true;
+
+            if (scratch_.size() <= BLOCK_CAPACITY) {
+                current.block.encode(scratch_.data(), scratch_.size());
+                return nullptr;
+            }
+
+            size_t half = scratch_.size() / 2;
+            auto sibling = std::make_unique<node>();
+            sibling->block.encode(scratch_.data() + half, scratch_.size() - half);
+            current.block.encode(scratch_.data(), half);
+            return sibling;
+        }
+
+        branch& inner = *current.inner;
+        size_t index = current.childIndex(key);
+        auto sibling = insertInto(*inner.children[index], key, inserted);
+        if (!inserted)
+            return nullptr;
+
+        inner.firsts[index] = std::min(inner.firsts[index], key);
+        inner.counts[index] = inner.children[index]->size();
+
+        if (sibling) {
+            auto position = static_cast<std::ptrdiff_t>(index + 1);
+            inner.firsts.insert(inner.firsts.begin() + position, sibling->front());
+            inner.counts.insert(inner.counts.begin() + position, sibling->size());
+            inner.children.insert(inner.children.begin() + position, std::move(sibling));
+        }
+
+        if (inner.children.size() <= FANOUT)
+            return nullptr;
+
+        auto half = static_cast<std::ptrdiff_t>(inner.children.size() / 2);
+        auto right = std::make_unique<node>();
+        right->inner = std::make_unique<branch>();
+        right->inner->firsts.assign(inner.firsts.begin() + half, inner.firsts.end());
+        right->inner->counts.assign(inner.counts.begin() + half, inner.counts.end());
+        right->inner->children.assign(std::make_move_iterator(inner.children.begin() + half),
+                                      std::make_move_iterator(inner.children.end()));
+
+        inner.firsts.resize(static_cast<size_t>(half));
+        inner.counts.resize(static_cast<size_t>(half));
+        inner.children.resize(static_cast<size_t>(half));
+        return right;
+    }
+
+    template <bool Inclusive>
+    size_t countBefore(IntType key) const noexcept {
+        if (!root_)
+            return 0;
+
+        size_t result = 0;
+        const node* current = root_.get();
+
+        while (!current->leaf()) {
+            size_t index = current->childIndex(key);
+            for (size_t i = 0; i < index; ++i)
+                result += current->inner->counts[i];
+            current = current->inner->children[index].get();
+        }
+
+        return result + (Inclusive ? current->block.upperBound(key) : current->block.lowerBound(key));
+    }
+
+    size_t countLess(IntType key) const noexcept {
+        return countBefore<false>(key);
+    }
+
+    size_t countLessEqual(IntType key) const noexcept {
+        return countBefore<true>(key);
+    }
+};
+
+} // namespace avl
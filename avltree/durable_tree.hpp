@@ -0,0 +1,321 @@
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "avl_tree.hpp"
+
+namespace avl {
+
+struct durability_options final {
+    size_t group_commit = 4096;             // inserts per WAL write + fdatasync
+    size_t checkpoint_interval = 1 << 22;   // logged inserts between checkpoints, 0 = never
+};
+
+struct recovery_info final {
+    size_t checkpoint_keys = 0;
+    size_t wal_records = 0;
+    size_t torn_bytes = 0;                  // incomplete or corrupt WAL tail that was cut off
+    std::chrono::microseconds duration{0};
+};
+
+namespace durability {
+
+static constexpr char CHECKPOINT_MAGIC[4] = {'A', 'V', 'L', 'C'};
+static constexpr const char* CHECKPOINT_FILE = "checkpoint";
+static constexpr const char* WAL_FILE = "wal";
+
+// FNV-1a, guards every WAL group against torn writes
+inline uint32_t checksum(const char* data, size_t size) noexcept {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+[[noreturn]] inline void fail(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+// Closes the descriptor when a write or sync throws halfway.
+class fd_guard final {
+ private:
+    int fd_;
+
+ public:
+    explicit fd_guard(int fd) noexcept : fd_(fd) {}
+    fd_guard(const fd_guard&) = delete;
+    fd_guard& operator=(const fd_guard&) = delete;
+
+    ~fd_guard() {
+        if (fd_ >= 0)
+            ::close(fd_);
+    }
+
+    int get() const noexcept {
+        return fd_;
+    }
+};
+
+inline void writeAll(int fd, const char* data, size_t size, const std::string& path) {
+    while (size > 0) {
+        ssize_t bytes = ::write(fd, data, size);
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        if (bytes <= 0)
+            fail("write " + path);
+        data += bytes;
+        size -= static_cast<size_t>(bytes);
+    }
+}
+
+inline std::vector<char> readFile(const std::filesystem::path& path) {
+    std::vector<char> data;
+    fd_guard fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd.get() < 0) {
+        if (errno == ENOENT)
+            return data;
+        fail("open " + path.string());
+    }
+
+    char buffer[1 << 16];
+    ssize_t bytes;
+    while ((bytes = ::read(fd.get(), buffer, sizeof(buffer))) != 0) {
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        if (bytes < 0)
+            fail("read " + path.string());
+        data.insert(data.end(), buffer, buffer + bytes);
+    }
+    return data;
+}
+
+inline void syncDirectory(const std::filesystem::path& directory) {
+    fd_guard fd(::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (fd.get() < 0)
+        fail("open " + directory.string());
+    if (::fsync(fd.get()) != 0)
+        fail("fsync " + directory.string());
+}
+
+} // namespace durability
+
+// avl_tree backed by a directory holding a checkpoint of the sorted key set and a write-ahead
+// log of the inserts made since. Inserts are logged in groups: one write and one fdatasync per
+// `group_commit` keys, so an insert is durable once commit() returns for its group.
+//   checkpoint: magic, uint64 count, sorted keys
+//   wal:        groups of {uint32 count, uint32 checksum, keys}
+// Recovery bulk-builds the checkpoint in O(n) and replays only the WAL groups after it.
+template <typename KeyType, typename BalancePolicy = avl_balance>
+class durable_tree final {
+    static_assert(std::is_trivially_copyable_v<KeyType>, "keys are logged as raw bytes");
+
+ private:
+    std::filesystem::path directory_;
+    durability_options options_;
+    avl_tree<KeyType, BalancePolicy> tree_;
+    int wal_fd_ = -1;
+    std::vector<KeyType> pending_;
+    size_t logged_since_checkpoint_ = 0;
+    recovery_info recovery_;
+
+ public:
+    explicit durable_tree(std::filesystem::path directory, durability_options options = {}) :
+        directory_(std::move(directory)), options_(options) {
+        std::filesystem::create_directories(directory_);
+        recover();
+        pending_.reserve(options_.group_commit);
+    }
+
+    durable_tree(const durable_tree&) = delete;
+    durable_tree& operator=(const durable_tree&) = delete;
+
+    ~durable_tree() {
+        try {
+            commit();
+        }
+        catch (...) {}
+        if (wal_fd_ >= 0)
+            ::close(wal_fd_);
+    }
+
+    bool insert(const KeyType& key) {
+        if (!tree_.insert(key))
+            return false;
+
+        pending_.push_back(key);
+        if (pending_.size() >= options_.group_commit)
+            commit();
+        return true;
+    }
+
+    // makes every insert so far durable
+    void commit() {
+        writeGroup();
+
+        if (options_.checkpoint_interval && logged_since_checkpoint_ >= options_.checkpoint_interval)
+            checkpoint();
+    }
+
+    // Writes the sorted key set next to the old checkpoint, renames it over and empties the WAL.
+    // A crash before the truncation only replays inserts the checkpoint already holds.
+    void checkpoint() {
+        writeGroup();
+
+        std::filesystem::path temporary = directory_ / (std::string(durability::CHECKPOINT_FILE) + ".tmp");
+        {
+            durability::fd_guard fd(::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+            if (fd.get() < 0)
+                durability::fail("open " + temporary.string());
+
+            std::vector<char> buffer;
+            buffer.reserve(CHECKPOINT_CHUNK + sizeof(KeyType));
+            uint64_t count = tree_.size();
+            buffer.insert(buffer.end(), durability::CHECKPOINT_MAGIC, durability::CHECKPOINT_MAGIC + 4);
+            buffer.insert(buffer.end(), reinterpret_cast<const char*>(&count), reinterpret_cast<const char*>(&count + 1));
+
+            for (auto it = tree_.begin(); it != tree_.end(); ++it) {
+                const char* key = reinterpret_cast<const char*>(&it->key_);
+                buffer.insert(buffer.end(), key, key + sizeof(KeyType));
+                if (buffer.size() >= CHECKPOINT_CHUNK) {
+                    durability::writeAll(fd.get(), buffer.data(), buffer.size(), temporary.string());
+                    buffer.clear();
+                }
+            }
+            durability::writeAll(fd.get(), buffer.data(), buffer.size(), temporary.string());
+
+            if (::fsync(fd.get()) != 0)
+                durability::fail("fsync " + temporary.string());
+        } // closed before the rename
+
+        std::filesystem::rename(temporary, checkpointPath());
+        durability::syncDirectory(directory_);
+
+        if (::ftruncate(wal_fd_, 0) != 0 || ::fsync(wal_fd_) != 0)
+            durability::fail("truncate " + walPath().string());
+        logged_since_checkpoint_ = 0;
+    }
+
+    size_t range_queries(const KeyType& first, const KeyType& second) const {
+        return tree_.range_queries(first, second);
+    }
+
+    size_t size() const noexcept {
+        return tree_.size();
+    }
+
+    const avl_tree<KeyType, BalancePolicy>& tree() const noexcept {
+        return tree_;
+    }
+
+    const recovery_info& recovery() const noexcept {
+        return recovery_;
+    }
+
+ private:
+    static constexpr size_t CHECKPOINT_CHUNK = 1 << 20;
+
+    std::filesystem::path checkpointPath() const {
+        return directory_ / durability::CHECKPOINT_FILE;
+    }
+
+    std::filesystem::path walPath() const {
+        return directory_ / durability::WAL_FILE;
+    }
+
+    void writeGroup() {
+        if (pending_.empty())
+            return;
+
+        auto count = static_cast<uint32_t>(pending_.size());
+        const char* keys = reinterpret_cast<const char*>(pending_.data());
+        size_t keys_size = pending_.size() * sizeof(KeyType);
+        uint32_t sum = durability::checksum(keys, keys_size);
+
+        std::vector<char> group(2 * sizeof(uint32_t) + keys_size);
+        std::memcpy(group.data(), &count, sizeof(count));
+        std::memcpy(group.data() + sizeof(count), &sum, sizeof(sum));
+        std::memcpy(group.data() + 2 * sizeof(uint32_t), keys, keys_size);
+
+        durability::writeAll(wal_fd_, group.data(), group.size(), walPath().string());
+        if (::fdatasync(wal_fd_) != 0)
+            durability::fail("fdatasync " + walPath().string());
+
+        logged_since_checkpoint_ += pending_.size();
+        pending_.clear();
+    }
+
+    void recover() {
+        auto begin = std::chrono::steady_clock::now();
+
+        std::vector<char> checkpoint = durability::readFile(checkpointPath());
+        if (!checkpoint.empty()) {
+            const size_t header = sizeof(durability::CHECKPOINT_MAGIC) + sizeof(uint64_t);
+            uint64_t count = 0;
+            if (checkpoint.size() >= header)
+                std::memcpy(&count, checkpoint.data() + sizeof(durability::CHECKPOINT_MAGIC), sizeof(count));
+
+            if (checkpoint.size() != header + count * sizeof(KeyType) ||
+                std::memcmp(checkpoint.data(), durability::CHECKPOINT_MAGIC, sizeof(durability::CHECKPOINT_MAGIC)) != 0) {
+                errno = EINVAL;
+                durability::fail("corrupt checkpoint " + checkpointPath().string());
+            }
+
+            std::vector<KeyType> keys(count);
+            std::memcpy(keys.data(), checkpoint.data() + header, count * sizeof(KeyType));
+            tree_ = avl_tree<KeyType, BalancePolicy>::build_from_sorted(keys);
+            recovery_.checkpoint_keys = keys.size();
+        }
+
+        std::vector<char> wal = durability::readFile(walPath());
+        size_t position = 0;
+        std::vector<KeyType> keys;
+
+        while (wal.size() - position >= 2 * sizeof(uint32_t)) {
+            uint32_t count, sum;
+            std::memcpy(&count, wal.data() + position, sizeof(count));
+            std::memcpy(&sum, wal.data() + position + sizeof(count), sizeof(sum));
+
+            size_t keys_size = size_t{count} * sizeof(KeyType);
+            const char* data = wal.data() + position + 2 * sizeof(uint32_t);
+            if (wal.size() - position - 2 * sizeof(uint32_t) < keys_size || durability::checksum(data, keys_size) != sum)
+                break;
+
+            keys.resize(count);
+            std::memcpy(keys.data(), data, keys_size);
+            for (const KeyType& key : keys)
+                tree_.insert(key);
+
+            recovery_.wal_records += count;
+            position += 2 * sizeof(uint32_t) + keys_size;
+        }
+
+        // O_APPEND: new groups follow the last intact one once the torn tail is cut off
+        wal_fd_ = ::open(walPath().c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (wal_fd_ < 0)
+            durability::fail("open " + walPath().string());
+        durability::syncDirectory(directory_); // the WAL entry itself must survive before any commit() does
+
+        recovery_.torn_bytes = wal.size() - position;
+        if (recovery_.torn_bytes && ::ftruncate(wal_fd_, static_cast<off_t>(position)) != 0)
+            durability::fail("truncate " + walPath().string());
+
+        logged_since_checkpoint_ = recovery_.wal_records;
+        recovery_.duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin);
+    }
+};
+
+} // namespace avl
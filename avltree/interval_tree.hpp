@@ -0,0 +1,143 @@
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "avl_tree.hpp"
+
+namespace avl {
+
+template <typename Coord>
+struct interval final {
+    Coord lo;
+    Coord hi;
+
+    auto operator<=>(const interval&) const = default;
+};
+
+// Largest right endpoint in the subtree.
+template <typename Coord>
+struct max_endpoint final {
+    using value_type = Coord;
+
+    template <typename Node>
+    static void update(Node& node) noexcept {
+        Coord result = node.key_.hi;
+        if (node.left_)
+            result = std::max(result, node.left_->augment_);
+        if (node.right_)
+            result = std::max(result, node.right_->augment_);
+        node.augment_ = result;
+    }
+};
+
+// Closed intervals [lo, hi] ordered by lo; repeated intervals are stored once.
+// The intervals overlapping [first, second] are the ones starting at or before `second`
+// minus the ones ending before `first`, so counting takes two rank queries: one on the
+// lo-ordered tree, one on a second tree ordered by hi. Enumeration walks the lo-ordered
+// tree in order and skips every subtree whose max_endpoint is below `first`.
+template <typename Coord>
+class interval_tree final {
+    static_assert(std::numeric_limits<Coord>::is_specialized, "bounds use numeric_limits<Coord>");
+
+ public:
+    using interval_type = interval<Coord>;
+    using tree_type = avl_tree<interval_type, avl_balance, max_endpoint<Coord>>;
+
+ private:
+    // pair sentinels: must not exceed (or undercut) any stored endpoint, infinities included
+    static constexpr Coord highest() noexcept {
+        if constexpr (std::numeric_limits<Coord>::has_infinity)
+            return std::numeric_limits<Coord>::infinity();
+        else
+            return std::numeric_limits<Coord>::max();
+    }
+
+    static constexpr Coord lowest() noexcept {
+        if constexpr (std::numeric_limits<Coord>::has_infinity)
+            return -std::numeric_limits<Coord>::infinity();
+        else
+            return std::numeric_limits<Coord>::lowest();
+    }
+
+    tree_type by_lo_;
+    avl_tree<std::pair<Coord, Coord>> by_hi_; // (hi, lo)
+
+ public:
+    // false for a repeated or an empty (hi < lo) interval
+    bool insert(const Coord& lo, const Coord& hi) {
+        if (hi < lo || !by_lo_.insert({lo, hi}))
+            return false;
+
+        by_hi_.insert({hi, lo});
+        return true;
+    }
+
+    size_t count_overlapping(const Coord& first, const Coord& second) const noexcept {
+        if (second < first)
+            return 0;
+
+        size_t started = by_lo_.count_less_equal({second, highest()});
+        size_t ended   = by_hi_.count_less({first, lowest()});
+        return started - ended;
+    }
+
+    // stabbing count: intervals containing `point`
+    size_t count_containing(const Coord& point) const noexcept {
+        return count_overlapping(point, point);
+    }
+
+    // calls function(interval) for every overlapping interval in lo order
+    template <typename Function>
+    void for_each_overlapping(const Coord& first, const Coord& second, Function function) const {
+        if (second < first)
+            return;
+
+        using node_type = std::remove_pointer_t<decltype(by_lo_.root.get())>;
+        std::vector<const node_type*> stack;
+        const node_type* node = by_lo_.root.get();
+
+        while (node || !stack.empty()) {
+            while (node && !(node->augment_ < first)) {
+                stack.push_back(node);
+                node = node->left_.get();
+            }
+            if (stack.empty())
+                return;
+
+            node = stack.back();
+            stack.pop_back();
+            if (second < node->key_.lo)
+                return;
+
+            if (!(node->key_.hi < first))
+                function(node->key_);
+            node = node->right_.get();
+        }
+    }
+
+    template <typename Function>
+    void for_each_containing(const Coord& point, Function function) const {
+        for_each_overlapping(point, point, std::move(function));
+    }
+
+    std::vector<interval_type> overlapping(const Coord& first, const Coord& second) const {
+        std::vector<interval_type> result;
+        for_each_overlapping(first, second, [&result](const interval_type& found) { result.push_back(found); });
+        return result;
+    }
+
+    size_t size() const noexcept {
+        return by_lo_.size();
+    }
+
+    const tree_type& tree() const noexcept {
+        return by_lo_;
+    }
+};
+
+} // namespace avl
@@ -1,11 +1,47 @@
 #include "avl_tree.hpp"
+#include "pipeline.hpp"
+#include "offline_engine.hpp"
+#include "sliding_window.hpp"
+#include "query_cache.hpp"
+#include <cstdio>
 #include <iostream>
 #include <limits>
+#include <string_view>
 
 void clearInput();
 
-int main() {
-    avl::avl_tree<int> tree;
+template <typename TreeType>
+void serve(TreeType& tree);
+
+int main(int argc, char** argv) {
+    avl::sliding_window<int> tree;
+
+    if (argc > 1 && std::string_view(argv[1]) == "--pipelined") {
+        avl::pipeline::run<avl::sliding_window<int>, int>(tree, stdin, std::cout);
+        return EXIT_SUCCESS;
+    }
+    else if (argc > 1 && std::string_view(argv[1]) == "--offline") {
+        avl::offline::run<int>(stdin, std::cout);
+        return EXIT_SUCCESS;
+    }
+    else if (argc > 1 && std::string_view(argv[1]) == "--cached") {
+        avl::cached_tree<int, avl::sliding_window<int>> cached;
+        serve(cached);
+        return EXIT_SUCCESS;
+    }
+    else if (argc > 1) {
+        std::cerr << "UNKNOWN OPTION -> " << argv[1] << "\n";
+        return EXIT_FAILURE;
+    }
+
+    serve(tree);
+
+    return EXIT_SUCCESS;
+}
+
+template <typename TreeType>
+void serve(TreeType& tree) {
+    std::ios::sync_with_stdio(false); // the window reclaimer thread would otherwise make every getc lock
     char request;
 
     while (std::cin >> request) {
@@ -26,6 +62,14 @@ int main() {
             }
             std::cout << tree.range_queries(first, second) << " ";
         }
+        else if (request == avl::window_request) {
+            int horizon;
+            while (!(std::cin >> horizon)) {
+                std::cerr << "WRONG GIVEN HORIZON -> " << horizon << "\n";
+                clearInput();
+            }
+            tree.expire_before(horizon);
+        }
         else {
             std::cerr << "WRONG REQUEST -> " << request << "\n";
             clearInput();
@@ -33,8 +77,6 @@ int main() {
     }
 
     std::cout << std::endl;
-
-    return EXIT_SUCCESS;
 }
 
 void clearInput() {
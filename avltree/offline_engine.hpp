@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+#include "avl_tree.hpp"
+#include "request_reader.hpp"
+
+namespace avl::offline {
+
+// Binary indexed tree over compressed key positions.
+class fenwick_tree final {
+ private:
+    std::vector<uint32_t> counts_;
+
+ public:
+    explicit fenwick_tree(size_t size) : counts_(size + 1, 0) {}
+
+    void add(size_t position) noexcept {
+        for (size_t i = position + 1; i < counts_.size(); i += i & (~i + 1))
+            ++counts_[i];
+    }
+
+    // number of marked positions in [0, position)
+    size_t prefix(size_t position) const noexcept {
+        size_t result = 0;
+        for (size_t i = position; i > 0; i -= i & (~i + 1))
+            result += counts_[i];
+        return result;
+    }
+};
+
+template <typename KeyType>
+size_t positionOf(const std::vector<KeyType>& keys, typename std::vector<KeyType>::const_iterator it) {
+    return static_cast<size_t>(it - keys.begin());
+}
+
+// Answers every query of a fully known request stream without building a tree:
+// inserted keys are coordinate-compressed and counted with a Fenwick tree.
+template <typename KeyType>
+std::vector<size_t> answer(const std::vector<request<KeyType>>& requests) {
+    std::vector<KeyType> keys;
+    for (const auto& req : requests) {
+        if (req.type == key_request)
+            keys.push_back(req.first);
+    }
+
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    assert(keys.size() < std::numeric_limits<uint32_t>::max());
+
+    fenwick_tree counts(keys.size());
+    std::vector<bool> inserted(keys.size(), false);
+    std::vector<size_t> answers;
+    std::optional<KeyType> horizon;
+
+    // The horizon only grows and older keys are ignored, so expired keys are
+    // exactly the counted ones below it: queries just start at the horizon.
+    for (const auto& req : requests) {
+        if (req.type == window_request) {
+            if (!horizon || *horizon < req.first)
+                horizon = req.first;
+        }
+        else if (req.type == key_request) {
+            if (horizon && req.first < *horizon)
+                continue;
+
+            size_t position = positionOf(keys, std::lower_bound(keys.begin(), keys.end(), req.first));
+            if (!inserted[position]) {
+                inserted[position] = true;
+                counts.add(position);
+            }
+        }
+        else {
+            if (req.first > req.second) {
+                answers.push_back(0);
+                continue;
+            }
+
+            KeyType first = horizon ? std::max(req.first, *horizon) : req.first;
+            if (first > req.second) {
+                answers.push_back(0);
+                continue;
+            }
+
+            size_t lower = positionOf(keys, std::lower_bound(keys.begin(), keys.end(), first));
+            size_t upper = positionOf(keys, std::upper_bound(keys.begin(), keys.end(), req.second));
+            answers.push_back(counts.prefix(upper) - counts.prefix(lower));
+        }
+    }
+
+    return answers;
+}
+
+template <typename KeyType>
+void run(std::FILE* input, std::ostream& output) {
+    std::vector<request<KeyType>> requests;
+    request_reader<KeyType> reader(input);
+
+    request<KeyType> req;
+    while (reader.next(req))
+        requests.push_back(req);
+
+    std::vector<size_t> answers = answer(requests);
+
+    std::vector<char> text(answers.size() * 21);
+    char* cursor = text.data();
+    for (size_t count : answers) {
+        cursor = std::to_chars(cursor, text.data() + text.size(), count).ptr;
+        *cursor++ = ' ';
+    }
+    output.write(text.data(), cursor - text.data());
+    output << std::endl;
+}
+
+} // namespace avl::offline
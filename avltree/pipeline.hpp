@@ -0,0 +1,105 @@
+#pragma once
+
+#include <charconv>
+#include <cstdio>
+#include <memory>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "avl_tree.hpp"
+#include "request_reader.hpp"
+#include "spsc_ring.hpp"
+
+namespace avl::pipeline {
+
+static constexpr size_t BATCH_SIZE = 4096;
+static constexpr size_t RING_SIZE  = 64;
+
+template <typename KeyType>
+struct request_batch final {
+    std::vector<request<KeyType>> requests;
+    bool last = false;
+};
+
+struct answer_batch final {
+    std::vector<size_t> answers;
+    bool last = false;
+};
+
+// Three-stage driver: the reader thread parses requests into batches, the calling thread
+// applies them to the tree and a formatter thread prints the answers in request order.
+template <typename TreeType, typename KeyType>
+void run(TreeType& tree, std::FILE* input, std::ostream& output) {
+    auto requests = std::make_unique<spsc_ring<request_batch<KeyType>, RING_SIZE>>();
+    auto answers  = std::make_unique<spsc_ring<answer_batch, RING_SIZE>>();
+
+    std::thread reader([&requests, input] {
+        request_reader<KeyType> parser(input);
+        request_batch<KeyType> batch;
+        batch.requests.reserve(BATCH_SIZE);
+
+        request<KeyType> req;
+        while (parser.next(req)) {
+            batch.requests.push_back(req);
+            if (batch.requests.size() == BATCH_SIZE) {
+                requests->push(std::move(batch));
+                batch = {};
+                batch.requests.reserve(BATCH_SIZE);
+            }
+        }
+
+        batch.last = true;
+        requests->push(std::move(batch));
+    });
+
+    std::thread formatter([&answers, &output] {
+        std::vector<char> text;
+
+        while (true) {
+            answer_batch batch = answers->pop();
+
+            text.resize(batch.answers.size() * 21);
+            char* cursor = text.data();
+            for (size_t answer : batch.answers) {
+                cursor = std::to_chars(cursor, text.data() + text.size(), answer).ptr;
+                *cursor++ = ' ';
+            }
+            output.write(text.data(), cursor - text.data());
+
+            if (batch.last)
+                break;
+        }
+
+        output << std::endl;
+    });
+
+    while (true) {
+        request_batch<KeyType> batch = requests->pop();
+        answer_batch result;
+        result.last = batch.last;
+
+        for (const auto& req : batch.requests) {
+            if (req.type == key_request) {
+                tree.insert(req.first);
+            }
+            else if (req.type == query_request) {
+                result.answers.push_back(tree.range_queries(req.first, req.second));
+            }
+            else if constexpr (requires { tree.expire_before(req.first); }) {
+                tree.expire_before(req.first);
+            }
+        }
+
+        if (!result.answers.empty() || result.last)
+            answers->push(std::move(result));
+
+        if (batch.last)
+            break;
+    }
+
+    reader.join();
+    formatter.join();
+}
+
+} // namespace avl::pipeline
@@ -0,0 +1,345 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "avl_tree.hpp"
+
+namespace avl {
+
+struct cache_stats final {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t adjustments = 0; // cached counts bumped by inserts
+    size_t evictions = 0;
+
+    double hit_rate() const noexcept {
+        size_t lookups = hits + misses;
+        return lookups ? static_cast<double>(hits) / static_cast<double>(lookups) : 0.0;
+    }
+};
+
+// Cached ranges ordered by (first, slot) in a treap whose nodes live in the cache slots; every
+// node keeps the largest `second` of its subtree, so the ranges containing a key are found
+// without visiting subtrees that end before it (interval tree, as in interval_tree.hpp).
+template <typename KeyType>
+class slot_interval_index final {
+    static constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+    struct node {
+        KeyType first;
+        KeyType second;
+        KeyType max_second;
+        uint32_t priority;
+        uint32_t left = none;
+        uint32_t right = none;
+    };
+
+    std::vector<node> nodes_;
+    uint32_t root_ = none;
+    uint32_t seed_ = 0x9e3779b9u;
+
+ public:
+    explicit slot_interval_index(size_t slots = 0) : nodes_(slots) {}
+
+    void insert(size_t slot, const KeyType& first, const KeyType& second) {
+        auto index = static_cast<uint32_t>(slot);
+        seed_ ^= seed_ << 13; seed_ ^= seed_ >> 17; seed_ ^= seed_ << 5; // xorshift32
+        nodes_[slot] = {first, second, second, seed_};
+        root_ = insertAt(root_, index);
+    }
+
+    void erase(size_t slot) {
+        root_ = eraseAt(root_, static_cast<uint32_t>(slot));
+    }
+
+    void clear() noexcept {
+        root_ = none;
+    }
+
+    // calls function(slot) for every range with first <= key <= second
+    template <typename Function>
+    void for_each_containing(const KeyType& key, Function function) const {
+        visit(root_, key, function);
+    }
+
+ private:
+    bool less(uint32_t a, uint32_t b) const noexcept {
+        if (nodes_[a].first < nodes_[b].first)
+            return true;
+        return !(nodes_[b].first < nodes_[a].first) && a < b;
+    }
+
+    void update(uint32_t index) noexcept {
+        node& current = nodes_[index];
+        current.max_second = current.second;
+        for (uint32_t child : {current.left, current.right}) {
+            if (child != none && current.max_second < nodes_[child].max_second)
+                current.max_second = nodes_[child].max_second;
+        }
+    }
+
+    // (less than `index`, the rest)
+    std::pair<uint32_t, uint32_t> split(uint32_t root, uint32_t index) {
+        if (root == none)
+            return {none, none};
+
+        if (less(root, index)) {
+            auto [left, right] = split(nodes_[root].right, index);
+            nodes_[root].right = left;
+            update(root);
+            return {root, right};
+        }
+
+        auto [left, right] = split(nodes_[root].left, index);
+        nodes_[root].left = right;
+        update(root);
+        return {left, root};
+    }
+
+    uint32_t merge(uint32_t left, uint32_t right) {
+        if (left == none)
+            return right;
+        if (right == none)
+            return left;
+
+        if (nodes_[left].priority > nodes_[right].priority) {
+            nodes_[left].right = merge(nodes_[left].right, right);
+            update(left);
+            return left;
+        }
+
+        nodes_[right].left = merge(left, nodes_[right].left);
+        update(right);
+        return right;
+    }
+
+    uint32_t insertAt(uint32_t root, uint32_t index) {
+        if (root == none)
+            return index;
+
+        if (nodes_[index].priority > nodes_[root].priority) {
+            auto [left, right] = split(root, index);
+            nodes_[index].left = left;
+            nodes_[index].right = right;
+            update(index);
+            return index;
+        }
+
+        if (less(index, root))
+            nodes_[root].left = insertAt(nodes_[root].left, index);
+        else
+            nodes_[root].right = insertAt(nodes_[root].right, index);
+        update(root);
+        return root;
+    }
+
+    uint32_t eraseAt(uint32_t root, uint32_t index) {
+        if (root == index)
+            return merge(nodes_[root].left, nodes_[root].right);
+
+        if (less(index, root))
+            nodes_[root].left = eraseAt(nodes_[root].left, index);
+        else
+            nodes_[root].right = eraseAt(nodes_[root].right, index);
+        update(root);
+        return root;
+    }
+
+    template <typename Function>
+    void visit(uint32_t root, const KeyType& key, Function& function) const {
+        while (root != none && !(nodes_[root].max_second < key)) {
+            const node& current = nodes_[root];
+            visit(current.left, key, function);
+            if (key < current.first)
+                return;
+
+            if (!(current.second < key))
+                function(static_cast<size_t>(root));
+            root = current.right;
+        }
+    }
+};
+
+// Range counts keyed by their bounds. Entries sit in one contiguous array and in a
+// slot_interval_index, so an insert adjusts only the cached ranges containing its key
+// instead of flushing or scanning them all. The entry count is derived from a byte limit;
+// a CLOCK hand picks eviction victims.
+template <typename KeyType, typename Hash = std::hash<KeyType>>
+class range_cache final {
+    using bounds = std::pair<KeyType, KeyType>;
+
+ public:
+    static constexpr size_t DEFAULT_MEMORY_LIMIT = 64 * 1024;
+
+ private:
+    struct entry {
+        KeyType first;
+        KeyType second;
+        size_t count;
+        bool referenced;
+    };
+
+    struct bounds_hash {
+        size_t operator()(const bounds& range) const noexcept {
+            size_t seed = Hash{}(range.first);
+            return seed ^ (Hash{}(range.second) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+        }
+    };
+
+    std::vector<entry> entries_;
+    std::unordered_map<bounds, size_t, bounds_hash> index_;
+    size_t capacity_;
+    slot_interval_index<KeyType> ranges_; // after capacity_: sized from it
+    size_t hand_ = 0;
+    cache_stats stats_;
+
+ public:
+    explicit range_cache(size_t memory_limit = DEFAULT_MEMORY_LIMIT) :
+        capacity_(memory_limit / entryBytes()), ranges_(capacity_) {
+        entries_.reserve(capacity_);
+        index_.reserve(capacity_);
+    }
+
+    std::optional<size_t> find(const KeyType& first, const KeyType& second) {
+        auto it = index_.find({first, second});
+        if (it == index_.end()) {
+            ++stats_.misses;
+            return std::nullopt;
+        }
+
+        ++stats_.hits;
+        entry& cached = entries_[it->second];
+        cached.referenced = true;
+        return cached.count;
+    }
+
+    void store(const KeyType& first, const KeyType& second, size_t count) {
+        if (capacity_ == 0)
+            return;
+
+        if (entries_.size() < capacity_) {
+            index_.emplace(bounds{first, second}, entries_.size());
+            ranges_.insert(entries_.size(), first, second);
+            entries_.push_back({first, second, count, false});
+            return;
+        }
+
+        while (entries_[hand_].referenced) {
+            entries_[hand_].referenced = false;
+            hand_ = (hand_ + 1) % capacity_;
+        }
+
+        entry& victim = entries_[hand_];
+        index_.erase({victim.first, victim.second});
+        ranges_.erase(hand_);
+        ++stats_.evictions;
+
+        victim = {first, second, count, false};
+        index_.emplace(bounds{first, second}, hand_);
+        ranges_.insert(hand_, first, second);
+        hand_ = (hand_ + 1) % capacity_;
+    }
+
+    // `key` was just added to the tree
+    void adjust(const KeyType& key) noexcept {
+        ranges_.for_each_containing(key, [this](size_t slot) {
+            ++entries_[slot].count;
+            ++stats_.adjustments;
+        });
+    }
+
+    void clear() noexcept {
+        entries_.clear();
+        index_.clear();
+        ranges_.clear();
+        hand_ = 0;
+    }
+
+    size_t size() const noexcept {
+        return entries_.size();
+    }
+
+    size_t capacity() const noexcept {
+        return capacity_;
+    }
+
+    const cache_stats& stats() const noexcept {
+        return stats_;
+    }
+
+    // estimate: the entry, its hash node, one bucket pointer and its interval index node
+    static constexpr size_t entryBytes() noexcept {
+        return sizeof(entry) + sizeof(std::pair<const bounds, size_t>) + 3 * sizeof(void*) + indexNodeBytes();
+    }
+
+    size_t memory_usage() const noexcept {
+        return sizeof(*this) + entries_.capacity() * sizeof(entry) +
+               index_.size() * (sizeof(std::pair<const bounds, size_t>) + 2 * sizeof(void*)) +
+               index_.bucket_count() * sizeof(void*) + capacity_ * indexNodeBytes();
+    }
+
+ private:
+    // first, second, max_second, priority and two slot links
+    static constexpr size_t indexNodeBytes() noexcept {
+        return 3 * sizeof(KeyType) + 3 * sizeof(uint32_t);
+    }
+};
+
+// Tree with a range_cache in front of range_queries(): repeated bounds are answered in O(1),
+// inserts that add a key adjust the cached counts. Window expiry flushes the cache.
+template <typename KeyType, typename TreeType = avl_tree<KeyType>>
+class cached_tree final {
+ private:
+    TreeType tree_;
+    range_cache<KeyType> cache_;
+
+ public:
+    explicit cached_tree(size_t memory_limit = range_cache<KeyType>::DEFAULT_MEMORY_LIMIT) : cache_(memory_limit) {}
+
+    bool insert(const KeyType& key) {
+        if (!tree_.insert(key))
+            return false;
+
+        cache_.adjust(key);
+        return true;
+    }
+
+    size_t range_queries(const KeyType& first, const KeyType& second) {
+        if (auto cached = cache_.find(first, second))
+            return *cached;
+
+        size_t count = tree_.range_queries(first, second);
+        cache_.store(first, second, count);
+        return count;
+    }
+
+    void expire_before(const KeyType& key) requires requires (TreeType& tree) { tree.expire_before(key); } {
+        tree_.expire_before(key);
+        cache_.clear();
+    }
+
+    size_t size() const noexcept {
+        return tree_.size();
+    }
+
+    const cache_stats& stats() const noexcept {
+        return cache_.stats();
+    }
+
+    const range_cache<KeyType>& cache() const noexcept {
+        return cache_;
+    }
+
+    const TreeType& tree() const noexcept {
+        return tree_;
+    }
+};
+
+} // namespace avl
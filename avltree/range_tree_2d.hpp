@@ -0,0 +1,262 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "avl_tree.hpp"
+
+namespace avl {
+
+// Bit vector with O(1) rank.
+class rank_bit_vector final {
+ private:
+    std::vector<uint64_t> words_;
+    std::vector<uint32_t> ranks_; // ones before every word
+
+ public:
+    explicit rank_bit_vector(size_t size = 0) : words_(size / 64 + 1, 0) {}
+
+    void set(size_t index) noexcept {
+        words_[index / 64] |= uint64_t{1} << (index % 64);
+    }
+
+    void build() {
+        ranks_.resize(words_.size());
+        uint32_t ones = 0;
+        for (size_t i = 0; i < words_.size(); ++i) {
+            ranks_[i] = ones;
+            ones += static_cast<uint32_t>(std::popcount(words_[i]));
+        }
+    }
+
+    bool get(size_t index) const noexcept {
+        return (words_[index / 64] >> (index % 64)) & 1;
+    }
+
+    // ones in [0, index)
+    size_t rank1(size_t index) const noexcept {
+        uint64_t mask = (uint64_t{1} << (index % 64)) - 1;
+        return ranks_[index / 64] + static_cast<size_t>(std::popcount(words_[index / 64] & mask));
+    }
+
+    size_t rank0(size_t index) const noexcept {
+        return index - rank1(index);
+    }
+};
+
+// Wavelet matrix over a sequence of values in [0, 2^bits).
+class wavelet_matrix final {
+ private:
+    size_t size_ = 0;
+    size_t bits_ = 0;
+    std::vector<rank_bit_vector> levels_;
+    std::vector<size_t> zeros_;
+
+ public:
+    wavelet_matrix() = default;
+
+    explicit wavelet_matrix(std::vector<uint32_t> values, uint32_t alphabet) :
+        size_(values.size()),
+        bits_(std::max<size_t>(1, static_cast<size_t>(std::bit_width(alphabet)))) {
+        std::vector<uint32_t> next(values.size());
+
+        for (size_t level = 0; level < bits_; ++level) {
+            size_t shift = bits_ - 1 - level;
+            rank_bit_vector bits(size_);
+
+            size_t zeros = 0;
+            for (size_t i = 0; i < size_; ++i) {
+                if ((values[i] >> shift) & 1)
+                    bits.set(i);
+                else
+                    ++zeros;
+            }
+            bits.build();
+
+            // stable partition: zeros first, then ones
+            size_t zero_pos = 0, one_pos = zeros;
+            for (size_t i = 0; i < size_; ++i)
+                next[(values[i] >> shift) & 1 ? one_pos++ : zero_pos++] = values[i];
+
+            values.swap(next);
+            levels_.push_back(std::move(bits));
+            zeros_.push_back(zeros);
+        }
+    }
+
+    // number of positions i in [first, last) with value < bound
+    size_t count_less(size_t first, size_t last, uint64_t bound) const noexcept {
+        if (first >= last)
+            return 0;
+        if (bound >= (uint64_t{1} << bits_))
+            return last - first;
+
+        size_t result = 0;
+        for (size_t level = 0; level < bits_; ++level) {
+            const rank_bit_vector& bits = levels_[level];
+            size_t first0 = bits.rank0(first);
+            size_t last0  = bits.rank0(last);
+
+            if ((bound >> (bits_ - 1 - level)) & 1) {
+                result += last0 - first0;
+                first = zeros_[level] + (first - first0);
+                last  = zeros_[level] + (last - last0);
+            }
+            else {
+                first = first0;
+                last  = last0;
+            }
+        }
+        return result;
+    }
+};
+
+// Immutable point set answering rectangle counts in O(log n + log sigma):
+// points sorted by x, their compressed y ranks kept in a wavelet matrix.
+template <typename Coord>
+class static_points_2d final {
+    using point = std::pair<Coord, Coord>;
+
+ private:
+    std::vector<point> points_; // sorted by (x, y)
+    std::vector<Coord> xs_;
+    std::vector<Coord> ys_;     // distinct y, sorted
+    wavelet_matrix matrix_;
+
+ public:
+    explicit static_points_2d(std::vector<point> points) : points_(std::move(points)) {
+        std::sort(points_.begin(), points_.end());
+
+        xs_.reserve(points_.size());
+        ys_.reserve(points_.size());
+        for (const auto& [x, y] : points_) {
+            xs_.push_back(x);
+            ys_.push_back(y);
+        }
+
+        std::sort(ys_.begin(), ys_.end());
+        ys_.erase(std::unique(ys_.begin(), ys_.end()), ys_.end());
+
+        std::vector<uint32_t> ranks;
+        ranks.reserve(points_.size());
+        for (const auto& [x, y] : points_)
+            ranks.push_back(static_cast<uint32_t>(std::lower_bound(ys_.begin(), ys_.end(), y) - ys_.begin()));
+
+        matrix_ = wavelet_matrix(std::move(ranks), static_cast<uint32_t>(ys_.size()));
+    }
+
+    size_t count(const Coord& x1, const Coord& x2, const Coord& y1, const Coord& y2) const noexcept {
+        if (x1 > x2 || y1 > y2)
+            return 0;
+
+        auto first = static_cast<size_t>(std::lower_bound(xs_.begin(), xs_.end(), x1) - xs_.begin());
+        auto last  = static_cast<size_t>(std::upper_bound(xs_.begin(), xs_.end(), x2) - xs_.begin());
+        auto low   = static_cast<uint64_t>(std::lower_bound(ys_.begin(), ys_.end(), y1) - ys_.begin());
+        auto high  = static_cast<uint64_t>(std::upper_bound(ys_.begin(), ys_.end(), y2) - ys_.begin());
+
+        return matrix_.count_less(first, last, high) - matrix_.count_less(first, last, low);
+    }
+
+    size_t size() const noexcept {
+        return points_.size();
+    }
+
+    const std::vector<point>& points() const noexcept {
+        return points_;
+    }
+};
+
+// Dynamic 2D point set with rectangle counting. Inserts go to a small buffer; full buffers are
+// merged into static_points_2d levels of doubling size (logarithmic method), so a count costs
+// O(log^2 n) and an insert O(log^2 n) amortised. Duplicate points are ignored, as in avl_tree.
+template <typename Coord>
+class range_tree_2d final {
+    using point = std::pair<Coord, Coord>;
+
+ public:
+    static constexpr size_t BUFFER_CAPACITY = 64;
+
+ private:
+    avl_tree<point> members_;
+    std::vector<point> buffer_;
+    std::vector<std::optional<static_points_2d<Coord>>> levels_;
+
+ public:
+    range_tree_2d() = default;
+
+    // Static mode: one wavelet-backed level built in O(n log n). It takes the first level large
+    // enough for it (level i holds up to BUFFER_CAPACITY * 2^i points), so later flushes only
+    // merge it once the levels below have filled up.
+    explicit range_tree_2d(std::vector<point> points) {
+        std::sort(points.begin(), points.end());
+        points.erase(std::unique(points.begin(), points.end()), points.end());
+        if (points.empty())
+            return;
+
+        members_ = avl_tree<point>::build_from_sorted(points);
+
+        size_t blocks = (points.size() + BUFFER_CAPACITY - 1) / BUFFER_CAPACITY;
+        levels_.resize(static_cast<size_t>(std::bit_width(blocks - 1)) + 1);
+        levels_.back().emplace(std::move(points));
+    }
+
+    bool insert(const Coord& x, const Coord& y) {
+        if (!members_.insert({x, y}))
+            return false;
+
+        buffer_.emplace_back(x, y);
+        if (buffer_.size() >= BUFFER_CAPACITY)
+            flushBuffer();
+        return true;
+    }
+
+    size_t count(const Coord& x1, const Coord& x2, const Coord& y1, const Coord& y2) const {
+        if (x1 > x2 || y1 > y2)
+            return 0;
+
+        size_t result = 0;
+        for (const auto& [x, y] : buffer_)
+            result += x1 <= x && x <= x2 && y1 <= y && y <= y2;
+
+        for (const auto& level : levels_) {
+            if (level)
+                result += level->count(x1, x2, y1, y2);
+        }
+        return result;
+    }
+
+    size_t size() const noexcept {
+        return members_.size();
+    }
+
+    // points held by every level, 0 for an empty one; buffered inserts are not included
+    std::vector<size_t> level_sizes() const {
+        std::vector<size_t> sizes;
+        for (const auto& level : levels_)
+            sizes.push_back(level ? level->size() : 0);
+        return sizes;
+    }
+
+ private:
+    void flushBuffer() {
+        std::vector<point> merged = std::move(buffer_);
+        buffer_.clear();
+
+        size_t level = 0;
+        for (; level < levels_.size() && levels_[level]; ++level) {
+            const auto& points = levels_[level]->points();
+            merged.insert(merged.end(), points.begin(), points.end());
+            levels_[level].reset();
+        }
+
+        if (level == levels_.size())
+            levels_.emplace_back();
+        levels_[level].emplace(std::move(merged));
+    }
+};
+
+} // namespace avl
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+#include "avl_tree.hpp"
+
+namespace avl {
+
+template <typename KeyType>
+struct request final {
+    char type;
+    KeyType first;
+    KeyType second;
+};
+
+// Buffered tokenizer for the k/q protocol. Accepts the same input as the std::cin based driver
+// and recovers the same way: an unknown request drops the rest of its line, malformed keys drop
+// the rest of theirs and are read again from the next line.
+template <typename KeyType>
+class request_reader final {
+    static_assert(std::is_integral_v<KeyType>, "request_reader parses integral keys only");
+
+ private:
+    std::FILE* file_;
+    std::vector<char> buffer_;
+    size_t pos_ = 0;
+    size_t end_ = 0;
+
+ public:
+    explicit request_reader(std::FILE* file, size_t buffer_size = 1 << 20) :
+        file_(file), buffer_(buffer_size) {}
+
+    bool next(request<KeyType>& req) {
+        while (true) {
+            skipSpaces();
+            int symbol = peek();
+            if (symbol == EOF)
+                return false;
+            ++pos_;
+
+            req.type = static_cast<char>(symbol);
+
+            if (req.type == key_request)
+                return retryLines([&] { return readKey(req.first); }, "WRONG GIVEN KEY\n");
+            if (req.type == query_request)
+                return retryLines([&] { return readKey(req.first) && readKey(req.second); }, "WRONG GIVEN BOUNDS\n");
+            if (req.type == window_request)
+                return retryLines([&] { return readKey(req.first); }, "WRONG GIVEN HORIZON\n");
+
+            std::cerr << "WRONG REQUEST -> " << req.type << "\n";
+            if (!skipLine())
+                return false;
+        }
+    }
+
+ private:
+    // false once the input ends before `read` succeeds
+    template <typename Read>
+    bool retryLines(Read read, const char* error) {
+        while (!read()) {
+            std::cerr << error;
+            if (!skipLine())
+                return false;
+        }
+        return true;
+    }
+
+    int peek() {
+        if (pos_ == end_) {
+            pos_ = 0;
+            end_ = std::fread(buffer_.data(), 1, buffer_.size(), file_);
+            if (end_ == 0)
+                return EOF;
+        }
+        return static_cast<unsigned char>(buffer_[pos_]);
+    }
+
+    void skipSpaces() {
+        int symbol = peek();
+        while (symbol != EOF && std::isspace(symbol)) {
+            ++pos_;
+            symbol = peek();
+        }
+    }
+
+    bool skipLine() {
+        int symbol = peek();
+        while (symbol != EOF && symbol != '\n') {
+            ++pos_;
+            symbol = peek();
+        }
+        if (symbol == EOF)
+            return false;
+
+        ++pos_;
+        return true;
+    }
+
+    bool readKey(KeyType& key) {
+        skipSpaces();
+
+        char digits[32];
+        size_t length = 0;
+        bool overflow = false;
+
+        int symbol = peek();
+        if (symbol == '-' || symbol == '+') {
+            if (symbol == '-')
+                digits[length++] = '-';
+            ++pos_;
+            symbol = peek();
+        }
+
+        size_t first_digit = length;
+        while (symbol != EOF && std::isdigit(symbol)) {
+            if (length < sizeof(digits))
+                digits[length++] = static_cast<char>(symbol);
+            else
+                overflow = true;
+            ++pos_;
+            symbol = peek();
+        }
+
+        if (length == first_digit || overflow)
+            return false;
+
+        auto [ptr, error] = std::from_chars(digits, digits + length, key);
+        return error == std::errc();
+    }
+};
+
+} // namespace avl
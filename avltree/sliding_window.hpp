@@ -0,0 +1,115 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#include "avl_tree.hpp"
+
+namespace avl {
+
+// Destroys handed-over objects on a background thread, so freeing a large detached
+// subtree does not stall the caller. The thread starts with the first retire(): a
+// single-threaded process keeps its cheap unlocked stdio until something expires.
+template <typename ValueType>
+class background_reclaimer final {
+ private:
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<ValueType> garbage_;
+    bool stopping_ = false;
+    std::thread worker_;
+
+ public:
+    background_reclaimer() = default;
+
+    background_reclaimer(const background_reclaimer&) = delete;
+    background_reclaimer& operator=(const background_reclaimer&) = delete;
+
+    ~background_reclaimer() {
+        {
+            std::lock_guard lock(mutex_);
+            stopping_ = true;
+        }
+        ready_.notify_one();
+        if (worker_.joinable())
+            worker_.join();
+    }
+
+    void retire(ValueType value) {
+        {
+            std::lock_guard lock(mutex_);
+            garbage_.push_back(std::move(value));
+        }
+
+        if (!worker_.joinable())
+            worker_ = std::thread([this] { run(); });
+        ready_.notify_one();
+    }
+
+ private:
+    void run() {
+        std::unique_lock lock(mutex_);
+        while (true) {
+            ready_.wait(lock, [this] { return stopping_ || !garbage_.empty(); });
+            if (garbage_.empty())
+                return;
+
+            ValueType value = std::move(garbage_.front());
+            garbage_.pop_front();
+
+            lock.unlock();
+            { ValueType discarded = std::move(value); }
+            lock.lock();
+        }
+    }
+};
+
+// Keys inside a moving window [horizon, +inf). expire_before() splits the expired prefix
+// off in O(log n) and frees it in the background; keys older than the horizon are ignored.
+template <typename KeyType>
+class sliding_window final {
+ private:
+    avl_tree<KeyType> tree_;
+    std::optional<KeyType> horizon_;
+    background_reclaimer<avl_tree<KeyType>> reclaimer_;
+
+ public:
+    bool insert(const KeyType& key) {
+        if (horizon_ && key < *horizon_)
+            return false;
+
+        return tree_.insert(key);
+    }
+
+    void expire_before(const KeyType& key) {
+        if (horizon_ && !(*horizon_ < key))
+            return;
+
+        horizon_ = key;
+        avl_tree<KeyType> expired = tree_.split_before(key);
+        if (!expired.empty())
+            reclaimer_.retire(std::move(expired));
+    }
+
+    size_t range_queries(const KeyType& first, const KeyType& second) const {
+        return tree_.range_queries(first, second);
+    }
+
+    size_t size() const noexcept {
+        return tree_.size();
+    }
+
+    const std::optional<KeyType>& horizon() const noexcept {
+        return horizon_;
+    }
+
+    const avl_tree<KeyType>& tree() const noexcept {
+        return tree_;
+    }
+};
+
+} // namespace avl
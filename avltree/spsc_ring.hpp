@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace avl {
+
+static constexpr size_t CACHE_LINE = 64;
+
+// Lock-free single-producer/single-consumer ring buffer.
+// Exactly one thread may call push() and exactly one other thread may call pop().
+// push() and pop() sleep on the opposite index while the ring is full or empty.
+template <typename ValueType, size_t Capacity>
+class spsc_ring final {
+    static_assert(Capacity > 1 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+ private:
+    std::array<ValueType, Capacity> slots_;
+
+    alignas(CACHE_LINE) std::atomic<size_t> head_ = 0; // next slot to pop
+    alignas(CACHE_LINE) std::atomic<size_t> tail_ = 0; // next slot to push
+
+ public:
+    bool try_push(ValueType& value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == Capacity)
+            return false;
+
+        slots_[tail & (Capacity - 1)] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        tail_.notify_one();
+        return true;
+    }
+
+    bool try_pop(ValueType& value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire))
+            return false;
+
+        value = std::move(slots_[head & (Capacity - 1)]);
+        head_.store(head + 1, std::memory_order_release);
+        head_.notify_one();
+        return true;
+    }
+
+    void push(ValueType value) {
+        while (!try_push(value))
+            head_.wait(tail_.load(std::memory_order_relaxed) - Capacity, std::memory_order_acquire);
+    }
+
+    ValueType pop() {
+        ValueType value;
+        while (!try_pop(value))
+            tail_.wait(head_.load(std::memory_order_relaxed), std::memory_order_acquire);
+
+        return value;
+    }
+};
+
+} // namespace avl
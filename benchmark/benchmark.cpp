@@ -1,16 +1,61 @@
 #include "avl_tree.hpp"
 #include "benchmark.hpp"
+#include "offline_engine.hpp"
 #include <iostream>
 #include <fstream>
 #include <set>
 #include <vector>
 #include <chrono>
+#include <string_view>
+#include <string>
 
 int main(int argc, char** argv) {
     std::ifstream input_data;
 
+    if (argc > 1 && std::string_view(argv[1]) == "--batched-lookups") {
+        size_t keys_count = argc > 2 ? std::stoull(argv[2]) : 10000000;
+        benchmark::runBatchedLookups(keys_count);
+        return EXIT_SUCCESS;
+    }
+
+    if (argc > 1 && std::string_view(argv[1]) == "--compressed") {
+        size_t keys_count = argc > 2 ? std::stoull(argv[2]) : 10000000;
+        benchmark::runCompressed(keys_count);
+        return EXIT_SUCCESS;
+    }
+
+    if (argc > 1 && std::string_view(argv[1]) == "--parallel") {
+        size_t keys_count = argc > 2 ? std::stoull(argv[2]) : 10000000;
+        benchmark::runParallel(keys_count);
+        return EXIT_SUCCESS;
+    }
+
+    if (argc > 1 && std::string_view(argv[1]) == "--range-2d") {
+        size_t points_count = argc > 2 ? std::stoull(argv[2]) : 1000000;
+        benchmark::runRangeTree2d(points_count);
+        return EXIT_SUCCESS;
+    }
+
+    if (argc > 1 && std::string_view(argv[1]) == "--cached") {
+        size_t requests_count = argc > 2 ? std::stoull(argv[2]) : 10000000;
+        benchmark::runCached(requests_count);
+        return EXIT_SUCCESS;
+    }
+
+    if (argc > 1 && std::string_view(argv[1]) == "--recovery") {
+        size_t keys_count = argc > 2 ? std::stoull(argv[2]) : 10000000;
+        benchmark::runRecovery(keys_count);
+        return EXIT_SUCCESS;
+    }
+
+    if (argc > 1 && std::string_view(argv[1]) == "--intervals") {
+        size_t intervals_count = argc > 2 ? std::stoull(argv[2]) : 1000000;
+        benchmark::runIntervals(intervals_count);
+        return EXIT_SUCCESS;
+    }
+
     if (argc > 1) {
-        input_data.open(argv[1]);
+        input_data.open(argv[1], std::ios::binary);
         std::cout << "benchmark data loaded from " << argv[1] << std::endl;
     }
     else {
@@ -31,13 +76,58 @@ int main(int argc, char** argv) {
     if (getBenchDataRes != 0)
         return EXIT_FAILURE;
 
+    if (benchmark::hasWindows(data)) {
+        // window trace: only expiring structures give comparable answers
+        avl::sliding_window<int> window;
+        auto window_result = benchmark::runTree<avl::sliding_window<int>, input_vector>(window, data);
+        std::cout << "sliding window: " << window_result.count() << " us\n";
+
+        std::vector<avl::request<int>> offline_data;
+        offline_data.reserve(data.size());
+        for (const auto& req : data)
+            offline_data.push_back({req.request, req.first, req.second});
+
+        auto offline_result = benchmark::measure([&] {
+            [[maybe_unused]] volatile size_t offline_answers = avl::offline::answer(offline_data).size();
+        });
+        std::cout << "offline:        " << offline_result.count() << " us\n";
+
+        benchmark::windowed_set<int> windowed;
+        auto windowed_result = benchmark::runTree<benchmark::windowed_set<int>, input_vector>(windowed, data);
+        std::cout << "std::set:       " << windowed_result.count() << " us\n";
+        return EXIT_SUCCESS;
+    }
+
     avl::avl_tree<int> avltree;
     auto avl_result = benchmark::runTree<avl::avl_tree<int>, input_vector>(avltree, data);
-    volatile size_t avl_bench = avl_result.count();
+    std::cout << "avl tree:   " << avl_result.count() << " us\n";
+//-------------------------------wavl tree benchmark-----------------------------------//
+    avl::avl_tree<int, avl::wavl_balance> wavltree;
+    auto wavl_result = benchmark::runTree<avl::avl_tree<int, avl::wavl_balance>, input_vector>(wavltree, data);
+    std::cout << "wavl tree:  " << wavl_result.count() << " us\n";
+//-------------------------------red-black tree benchmark------------------------------//
+    avl::avl_tree<int, avl::rb_balance> rbtree;
+    auto rb_result = benchmark::runTree<avl::avl_tree<int, avl::rb_balance>, input_vector>(rbtree, data);
+    std::cout << "rb tree:    " << rb_result.count() << " us\n";
+//-------------------------------treap benchmark---------------------------------------//
+    avl::avl_tree<int, avl::treap_balance> treap;
+    auto treap_result = benchmark::runTree<avl::avl_tree<int, avl::treap_balance>, input_vector>(treap, data);
+    std::cout << "treap:      " << treap_result.count() << " us\n";
+//-------------------------------offline engine benchmark------------------------------//
+    std::vector<avl::request<int>> offline_data;
+    offline_data.reserve(data.size());
+    for (const auto& req : data)
+        offline_data.push_back({req.request, req.first, req.second});
+
+    auto offline_begin = std::chrono::high_resolution_clock::now();
+    [[maybe_unused]] volatile size_t offline_answers = avl::offline::answer(offline_data).size();
+    auto offline_end = std::chrono::high_resolution_clock::now();
+    auto offline_result = std::chrono::duration_cast<std::chrono::microseconds>(offline_end - offline_begin);
+    std::cout << "offline:    " << offline_result.count() << " us\n";
 //-------------------------------std::set benchmark------------------------------------//
     std::set<int> settree;
     auto set_result = benchmark::runTree<std::set<int>, input_vector>(settree, data);
-    volatile size_t set_bench = set_result.count();
+    std::cout << "std::set:   " << set_result.count() << " us\n";
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
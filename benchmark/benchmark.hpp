@@ -4,11 +4,26 @@
 #include <fstream>
 #include <set>
 #include <chrono>
+#include <random>
+#include <algorithm>
+#include <vector>
+#include <array>
+#include <limits>
+#include <optional>
+
+#include "workload.hpp"
+#include "compressed_set.hpp"
+#include "range_tree_2d.hpp"
+#include "query_cache.hpp"
+#include "durable_tree.hpp"
+#include "interval_tree.hpp"
+#include "sliding_window.hpp"
 
 namespace benchmark {
 
-const char key_request   = 'k';
-const char query_request = 'q';
+const char key_request    = 'k';
+const char query_request  = 'q';
+const char window_request = 'w';
 
 template <typename KeyType>
 struct Request {
@@ -21,6 +36,12 @@ struct Request {
 
 template <typename KeyType, typename VecType>
 int getBenchmarkData(VecType& data, std::ifstream& input_data) {
+    if (workload::isBinary(input_data)) {
+        for (const auto& req : workload::readBinary(input_data))
+            data.emplace_back(req.type, static_cast<KeyType>(req.first), static_cast<KeyType>(req.second));
+        return EXIT_SUCCESS;
+    }
+
     char request;
     while (input_data >> request) {
         if (request == key_request) {
@@ -39,6 +60,14 @@ int getBenchmarkData(VecType& data, std::ifstream& input_data) {
             }
             data.emplace_back(request, first, second);
         }
+        else if (request == window_request) {
+            KeyType horizon;
+            if (!(input_data >> horizon)) {
+                std::cerr << "WRONG GIVEN HORIZON\n";
+                return EXIT_FAILURE;
+            }
+            data.emplace_back(request, horizon);
+        }
         else {
             std::cerr << "WRONG REQUEST -> " << request << "\n";
             return EXIT_FAILURE;
@@ -64,8 +93,8 @@ size_t set_range_queries(const TreeType& tree, const KeyType& first, const KeyTy
 }
 #endif
 
-template <typename KeyType>
-size_t set_range_queries(const avl::avl_tree<KeyType>& tree, const KeyType& first, const KeyType& second) {
+template <typename KeyType, typename BalancePolicy>
+size_t set_range_queries(const avl::avl_tree<KeyType, BalancePolicy>& tree, const KeyType& first, const KeyType& second) {
     if (first > second)
         return 0;
 
@@ -83,22 +112,482 @@ size_t set_range_queries(const std::set<KeyType>& tree, const KeyType& first, co
     return std::distance(lower, upper);
 }
 
+// One clock around the whole trace: timing each request alone truncates sub-microsecond ones to 0.
+// std::set baseline for windowed traces, with the sliding_window rules: expire_before() erases
+// the prefix and keys older than the horizon are ignored.
+template <typename KeyType>
+class windowed_set final {
+ private:
+    std::set<KeyType> set_;
+    std::optional<KeyType> horizon_;
+
+ public:
+    void insert(const KeyType& key) {
+        if (!horizon_ || !(key < *horizon_))
+            set_.insert(key);
+    }
+
+    void expire_before(const KeyType& key) {
+        if (horizon_ && !(*horizon_ < key))
+            return;
+
+        horizon_ = key;
+        set_.erase(set_.begin(), set_.lower_bound(key));
+    }
+
+    const std::set<KeyType>& set() const noexcept {
+        return set_;
+    }
+};
+
+template <typename KeyType>
+size_t set_range_queries(const windowed_set<KeyType>& tree, const KeyType& first, const KeyType& second) {
+    return set_range_queries(tree.set(), first, second);
+}
+
+template <typename KeyType>
+size_t set_range_queries(const avl::sliding_window<KeyType>& tree, const KeyType& first, const KeyType& second) {
+    if (first > second)
+        return 0;
+
+    return tree.range_queries(first, second);
+}
+
+template <typename VecType>
+bool hasWindows(const VecType& data) {
+    return std::any_of(data.begin(), data.end(), [](const auto& req) { return req.request == window_request; });
+}
+
+// 'w' requests are applied by trees with expire_before(); main() only runs the others on traces without them.
 template <typename TreeType, typename VecType>
 auto runTree(TreeType& tree, const VecType& data) {
-    volatile size_t dummy = 0;
-    auto result = std::chrono::microseconds::zero();
+    [[maybe_unused]] volatile size_t dummy = 0;
+    auto begin = std::chrono::high_resolution_clock::now();
     for (const auto& req : data) {
-        auto begin = std::chrono::high_resolution_clock::now();
         if (req.request == key_request) {
             tree.insert(req.first);
         }
         else if (req.request == query_request) {
             dummy = set_range_queries(tree, req.first, req.second);
         }
-        auto end = std::chrono::high_resolution_clock::now();
-        result += std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
+        else if constexpr (requires { tree.expire_before(req.first); }) {
+            tree.expire_before(req.first);
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
+}
+template <typename Function>
+auto measure(Function function) {
+    auto begin = std::chrono::high_resolution_clock::now();
+    function();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
+}
+
+// Sequential find/lower_bound against the interleaved batch API on a tree far larger than LLC.
+inline void runBatchedLookups(size_t keys_count, size_t lookups_count = 10000000) {
+    std::mt19937_64 gen(2024);
+    std::uniform_int_distribution<long long> dist(0, static_cast<long long>(keys_count) * 4);
+
+    avl::avl_tree<long long> tree;
+    for (size_t i = 0; i < keys_count; ++i)
+        tree.insert(dist(gen));
+
+    std::vector<long long> keys(lookups_count);
+    for (auto& key : keys)
+        key = dist(gen);
+
+    using iterator = avl::avl_tree<long long>::iterator;
+    std::vector<iterator> result(lookups_count);
+    volatile size_t dummy = 0;
+
+    auto sequential_find = measure([&] {
+        size_t found = 0;
+        for (size_t i = 0; i < lookups_count; ++i)
+            found += tree.find(keys[i]).second == avl::FindFlags::exists;
+        dummy = found;
+    });
+    auto batch_find = measure([&] {
+        tree.find_batch(keys, result);
+    });
+    auto sequential_lower = measure([&] {
+        for (size_t i = 0; i < lookups_count; ++i)
+            result[i] = tree.lower_bound(keys[i]);
+    });
+    auto batch_lower = measure([&] {
+        tree.lower_bound_batch(keys, result);
+    });
+
+    std::cout << "tree size:            " << tree.size() << " keys\n"
+              << "find:                 " << sequential_find.count()  << " us\n"
+              << "find_batch:           " << batch_find.count()       << " us\n"
+              << "lower_bound:          " << sequential_lower.count() << " us\n"
+              << "lower_bound_batch:    " << batch_lower.count()      << " us\n";
+}
+
+// Footprint and range query speed of compressed_set against avl_tree on dense, clustered 64-bit keys.
+inline void runCompressed(size_t keys_count, size_t queries_count = 1000000) {
+    std::mt19937_64 gen(2025);
+    std::vector<int64_t> keys(keys_count);
+    for (size_t i = 0; i < keys_count; ++i)
+        keys[i] = (int64_t{1} << 40) + static_cast<int64_t>(i * 3 + gen() % 3);
+    std::shuffle(keys.begin(), keys.end(), gen);
+
+    avl::compressed_set<int64_t> compressed;
+    avl::avl_tree<int64_t> tree;
+
+    auto compressed_insert = measure([&] {
+        for (int64_t key : keys)
+            compressed.insert(key);
+    });
+    auto tree_insert = measure([&] {
+        for (int64_t key : keys)
+            tree.insert(key);
+    });
+
+    std::uniform_int_distribution<int64_t> dist(int64_t{1} << 40, (int64_t{1} << 40) + static_cast<int64_t>(keys_count) * 3);
+    std::vector<std::pair<int64_t, int64_t>> bounds(queries_count);
+    for (auto& [first, second] : bounds) {
+        first = dist(gen);
+        second = first + static_cast<int64_t>(gen() % 100000);
+    }
+
+    volatile size_t dummy = 0;
+    auto compressed_query = measure([&] {
+        size_t total = 0;
+        for (auto [first, second] : bounds)
+            total += compressed.range_queries(first, second);
+        dummy = total;
+    });
+    auto tree_query = measure([&] {
+        size_t total = 0;
+        for (auto [first, second] : bounds)
+            total += tree.range_queries(first, second);
+        dummy = total;
+    });
+
+    auto bytes_per_key = [](size_t bytes, size_t keys) {
+        return static_cast<double>(bytes) / static_cast<double>(std::max<size_t>(keys, 1));
+    };
+
+    std::cout << "keys:                   " << compressed.size() << "\n"
+              << "compressed bytes/key:   " << bytes_per_key(compressed.memory_usage(), compressed.size()) << "\n"
+              << "avl tree bytes/key:     " << bytes_per_key(tree.memory_usage().total(), tree.size()) << "\n"
+              << "compressed insert:      " << compressed_insert.count() << " us\n"
+              << "avl tree insert:        " << tree_insert.count()       << " us\n"
+              << "compressed queries:     " << compressed_query.count()  << " us\n"
+              << "avl tree queries:       " << tree_query.count()        << " us\n";
+}
+
+// Sequential walk against parallel_count_if/parallel_reduce over the whole tree.
+inline void runParallel(size_t keys_count) {
+    std::mt19937_64 gen(2026);
+    avl::avl_tree<long long> tree;
+    for (size_t i = 0; i < keys_count; ++i)
+        tree.insert(static_cast<long long>(gen() >> 1));
+
+    auto predicate = [](long long key) { return key % 7 == 3; };
+    auto map = [](long long key) { return static_cast<double>(key % 1000) * 0.5; };
+    volatile size_t dummy = 0;
+
+    auto sequential = measure([&] {
+        size_t count = 0;
+        double sum = 0;
+        for (auto it = tree.begin(); it != tree.end(); ++it) {
+            count += predicate(it->key_);
+            sum += map(it->key_);
+        }
+        dummy = count + static_cast<size_t>(sum);
+    });
+
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    auto parallel = measure([&] {
+        size_t count = tree.parallel_count_if(predicate, threads);
+        double sum = tree.parallel_reduce(0.0, map, std::plus<double>(), threads);
+        dummy = count + static_cast<size_t>(sum);
+    });
+
+    std::cout << "keys:                   " << tree.size() << "\n"
+              << "threads:                " << threads << "\n"
+              << "sequential:             " << sequential.count() << " us\n"
+              << "parallel:               " << parallel.count() << " us\n";
+}
+
+// Brute-force reference for rectangle counts: scan the x range of a lexicographic set.
+template <typename KeyType>
+size_t set_rectangle_count(const std::set<std::pair<KeyType, KeyType>>& points,
+                           KeyType x1, KeyType x2, KeyType y1, KeyType y2) {
+    if (x1 > x2 || y1 > y2)
+        return 0;
+
+    size_t count = 0;
+    auto last = points.upper_bound({x2, std::numeric_limits<KeyType>::max()});
+    for (auto it = points.lower_bound({x1, std::numeric_limits<KeyType>::min()}); it != last; ++it)
+        count += y1 <= it->second && it->second <= y2;
+    return count;
+}
+
+// range_tree_2d (dynamic and static) against one avl_tree per x bucket and the std::set scan.
+inline void runRangeTree2d(size_t points_count, size_t queries_count = 10000) {
+    const int x_range = 1 << 16;
+    const int y_range = 1 << 30;
+
+    std::mt19937_64 gen(2027);
+    std::uniform_int_distribution<int> x_dist(0, x_range - 1), y_dist(0, y_range - 1);
+    std::vector<std::pair<int, int>> points(points_count);
+    for (auto& [x, y] : points) {
+        x = x_dist(gen);
+        y = y_dist(gen);
     }
 
-    return result;
+    std::vector<std::array<int, 4>> rectangles(queries_count);
+    for (auto& [x1, x2, y1, y2] : rectangles) {
+        x1 = x_dist(gen);
+        x2 = std::min(x_range - 1, x1 + x_dist(gen) / 8);
+        y1 = y_dist(gen);
+        y2 = y1 + y_dist(gen) / 4;
+    }
+
+    avl::range_tree_2d<int> dynamic_tree;
+    std::vector<avl::avl_tree<int>> buckets(x_range);
+    std::set<std::pair<int, int>> reference;
+
+    auto dynamic_insert = measure([&] {
+        for (auto [x, y] : points)
+            dynamic_tree.insert(x, y);
+    });
+    auto static_build = measure([&] {
+        avl::range_tree_2d<int> static_tree(points);
+    });
+    auto buckets_insert = measure([&] {
+        for (auto [x, y] : points)
+            buckets[static_cast<size_t>(x)].insert(y);
+    });
+    for (const auto& point : points)
+        reference.insert(point);
+
+    avl::range_tree_2d<int> static_tree(points);
+    volatile size_t dummy = 0;
+
+    auto run_queries = [&](auto count) {
+        return measure([&] {
+            size_t total = 0;
+            for (auto [x1, x2, y1, y2] : rectangles)
+                total += count(x1, x2, y1, y2);
+            dummy = total;
+        });
+    };
+
+    auto dynamic_query = run_queries([&](int x1, int x2, int y1, int y2) {
+        return dynamic_tree.count(x1, x2, y1, y2);
+    });
+    auto static_query = run_queries([&](int x1, int x2, int y1, int y2) {
+        return static_tree.count(x1, x2, y1, y2);
+    });
+    auto buckets_query = run_queries([&](int x1, int x2, int y1, int y2) {
+        size_t total = 0;
+        for (int x = x1; x <= x2; ++x)
+            total += buckets[static_cast<size_t>(x)].range_queries(y1, y2);
+        return total;
+    });
+    auto set_query = run_queries([&](int x1, int x2, int y1, int y2) {
+        return set_rectangle_count(reference, x1, x2, y1, y2);
+    });
+
+    std::cout << "points:                 " << dynamic_tree.size() << "\n"
+              << "queries:                " << queries_count << "\n"
+              << "range tree insert:      " << dynamic_insert.count() << " us\n"
+              << "static build:           " << static_build.count()   << " us\n"
+              << "x buckets insert:       " << buckets_insert.count() << " us\n"
+              << "range tree queries:     " << dynamic_query.count()  << " us\n"
+              << "static queries:         " << static_query.count()   << " us\n"
+              << "x buckets queries:      " << buckets_query.count()  << " us\n"
+              << "std::set scan queries:  " << set_query.count()      << " us\n";
 }
-} // namespace benchmark
\ No newline at end of file
+
+// Queries drawn from a few hundred hot ranges mixed with inserts, with and without range_cache.
+inline void runCached(size_t requests_count, size_t hot_ranges = 256) {
+    std::mt19937_64 gen(2028);
+    std::uniform_int_distribution<int> keys(0, 1 << 28);
+
+    std::vector<int> initial(1000000);
+    for (auto& key : initial)
+        key = keys(gen);
+
+    std::vector<std::pair<int, int>> hot(hot_ranges);
+    for (auto& [first, second] : hot) {
+        first = keys(gen);
+        second = first + keys(gen) / 64;
+    }
+
+    std::cout << "requests:               " << requests_count << "\n"
+              << "hot ranges:             " << hot_ranges << "\n";
+
+    // query-heavy (one insert per 16 requests), then insert-heavy (one per 2): every insert
+    // adjusts the cached ranges containing its key
+    for (size_t insert_every : {16, 2}) {
+        avl::avl_tree<int> tree;
+        avl::cached_tree<int> cached;
+        for (int key : initial) {
+            tree.insert(key);
+            cached.insert(key);
+        }
+
+        std::vector<Request<int>> requests;
+        requests.reserve(requests_count);
+        for (size_t i = 0; i < requests_count; ++i) {
+            if (i % insert_every == 0) {
+                requests.emplace_back(key_request, keys(gen));
+            }
+            else {
+                auto [first, second] = hot[gen() % hot.size()];
+                requests.emplace_back(query_request, first, second);
+            }
+        }
+
+        volatile size_t dummy = 0;
+        auto run = [&](auto& target) {
+            return measure([&] {
+                size_t total = 0;
+                for (const auto& req : requests) {
+                    if (req.request == key_request)
+                        target.insert(req.first);
+                    else
+                        total += target.range_queries(req.first, req.second);
+                }
+                dummy = total;
+            });
+        };
+
+        auto tree_result = run(tree);
+        auto cached_result = run(cached);
+
+        std::cout << "one insert per:         " << insert_every << " requests\n"
+                  << "cache entries:          " << cached.cache().size() << " / " << cached.cache().capacity() << "\n"
+                  << "hit rate:               " << cached.stats().hit_rate() << "\n"
+                  << "avl tree:               " << tree_result.count()   << " us\n"
+                  << "cached tree:            " << cached_result.count() << " us\n";
+    }
+}
+
+// Group commit against per-insert fdatasync, then recovery from the WAL alone and
+// from a checkpoint taken at 90% plus the WAL tail.
+inline void runRecovery(size_t keys_count, size_t synced_count = 2000) {
+    auto directory = std::filesystem::temp_directory_path() / "avl_recovery_benchmark";
+    std::mt19937_64 gen(2029);
+    std::vector<int> keys(keys_count);
+    for (auto& key : keys)
+        key = static_cast<int>(gen() >> 33);
+
+    auto per_insert = [](std::chrono::microseconds time, size_t count) {
+        return static_cast<double>(time.count()) / static_cast<double>(std::max<size_t>(count, 1));
+    };
+
+    std::filesystem::remove_all(directory);
+    synced_count = std::min(synced_count, keys_count);
+    auto synced = measure([&] {
+        avl::durable_tree<int> tree(directory, {.group_commit = 1, .checkpoint_interval = 0});
+        for (size_t i = 0; i < synced_count; ++i)
+            tree.insert(keys[i]);
+    });
+
+    std::filesystem::remove_all(directory);
+    auto grouped = measure([&] {
+        avl::durable_tree<int> tree(directory, {.group_commit = 4096, .checkpoint_interval = 0});
+        for (int key : keys)
+            tree.insert(key);
+    });
+
+    avl::recovery_info wal_only = avl::durable_tree<int>(directory).recovery();
+
+    std::filesystem::remove_all(directory);
+    {
+        avl::durable_tree<int> tree(directory, {.group_commit = 4096, .checkpoint_interval = 0});
+        for (size_t i = 0; i < keys_count; ++i) {
+            tree.insert(keys[i]);
+            if (i + 1 == keys_count * 9 / 10)
+                tree.checkpoint();
+        }
+    }
+    avl::recovery_info with_checkpoint = avl::durable_tree<int>(directory).recovery();
+    std::filesystem::remove_all(directory);
+
+    std::cout << "keys:                   " << keys_count << "\n"
+              << "fdatasync per insert:   " << per_insert(synced, synced_count) << " us/insert\n"
+              << "group commit (4096):    " << per_insert(grouped, keys_count) << " us/insert\n"
+              << "recovery, WAL only:     " << wal_only.duration.count() << " us ("
+              << wal_only.wal_records << " replayed)\n"
+              << "recovery, checkpoint:   " << with_checkpoint.duration.count() << " us ("
+              << with_checkpoint.checkpoint_keys << " bulk built, " << with_checkpoint.wal_records << " replayed)\n";
+}
+
+// interval_tree overlap counts, stabbing counts and enumeration against a brute-force scan.
+inline void runIntervals(size_t intervals_count, size_t queries_count = 2000) {
+    std::mt19937_64 gen(2030);
+    std::uniform_int_distribution<int> position(0, 1 << 30), length(0, 1 << 16);
+
+    std::vector<avl::interval<int>> intervals(intervals_count);
+    for (auto& [lo, hi] : intervals) {
+        lo = position(gen);
+        hi = lo + length(gen);
+    }
+
+    std::vector<std::pair<int, int>> queries(queries_count);
+    for (auto& [first, second] : queries) {
+        first = position(gen);
+        second = first + length(gen) * 4;
+    }
+
+    avl::interval_tree<int> tree;
+    auto build = measure([&] {
+        for (auto [lo, hi] : intervals)
+            tree.insert(lo, hi);
+    });
+
+    volatile size_t dummy = 0;
+    auto run_queries = [&](auto count) {
+        return measure([&] {
+            size_t total = 0;
+            for (auto [first, second] : queries)
+                total += count(first, second);
+            dummy = total;
+        });
+    };
+
+    auto tree_overlap = run_queries([&](int first, int second) {
+        return tree.count_overlapping(first, second);
+    });
+    auto tree_stabbing = run_queries([&](int first, int) {
+        return tree.count_containing(first);
+    });
+    auto tree_enumerate = run_queries([&](int first, int second) {
+        size_t found = 0;
+        tree.for_each_overlapping(first, second, [&found](const avl::interval<int>&) { ++found; });
+        return found;
+    });
+    auto scan_overlap = run_queries([&](int first, int second) {
+        size_t found = 0;
+        for (auto [lo, hi] : intervals)
+            found += lo <= second && first <= hi;
+        return found;
+    });
+    auto scan_stabbing = run_queries([&](int first, int) {
+        size_t found = 0;
+        for (auto [lo, hi] : intervals)
+            found += lo <= first && first <= hi;
+        return found;
+    });
+
+    std::cout << "intervals:              " << tree.size() << "\n"
+              << "queries:                " << queries_count << "\n"
+              << "interval tree build:    " << build.count()          << " us\n"
+              << "overlap counts:         " << tree_overlap.count()   << " us\n"
+              << "stabbing counts:        " << tree_stabbing.count()  << " us\n"
+              << "overlap enumeration:    " << tree_enumerate.count() << " us\n"
+              << "scan overlap counts:    " << scan_overlap.count()   << " us\n"
+              << "scan stabbing counts:   " << scan_stabbing.count()  << " us\n";
+}
+
+} // namespace benchmark
@@ -0,0 +1,246 @@
+#include "protocol.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string unix_path;
+    int tcp_port       = -1;
+    size_t connections = 4;
+    size_t depth       = 64;   // queries in flight per connection
+    bool binary        = false;
+    workload::Config config;
+};
+
+struct ConnectionResult {
+    size_t requests = 0;
+    size_t errors = 0;
+    std::vector<double> latencies; // microseconds, one per query
+    bool ok = false;
+};
+
+void printUsage() {
+    std::cerr << "usage: avl_loadgen (--unix PATH | --tcp PORT) [options]\n"
+                 "  --connections C      parallel client connections (default 4)\n"
+                 "  --ops N              requests per connection (default 200000)\n"
+                 "  --depth D            queries in flight per connection (default 64)\n"
+                 "  --insert-ratio R     share of 'k' requests in [0, 1] (default 0.5)\n"
+                 "  --distribution D     uniform | zipf | sequential | clustered | adversarial\n"
+                 "  --min K --max K      key range (default -2000000 2000000)\n"
+                 "  --range-width W      query width; omit for independent bounds\n"
+                 "  --seed S             random seed, connection i uses S + i (default 1)\n"
+                 "  --binary             use the length-prefixed binary framing\n";
+}
+
+int connectTo(const Options& options) {
+    if (!options.unix_path.empty()) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (options.unix_path.size() >= sizeof(address.sun_path))
+            return -1;
+        options.unix_path.copy(address.sun_path, options.unix_path.size());
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(options.tcp_port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    return fd;
+}
+
+bool writeAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t bytes = write(fd, data.data(), data.size());
+        if (bytes <= 0)
+            return false;
+        data.remove_prefix(static_cast<size_t>(bytes));
+    }
+    return true;
+}
+
+// Keeps up to `depth` queries outstanding and times each from send to answer.
+ConnectionResult runConnection(const Options& options, const std::vector<workload::Request>& requests) {
+    ConnectionResult result;
+    int fd = connectTo(options);
+    if (fd < 0)
+        return result;
+
+    if (options.binary && !writeAll(fd, std::string_view(server::BINARY_MAGIC, sizeof(server::BINARY_MAGIC)))) {
+        close(fd);
+        return result;
+    }
+
+    std::deque<Clock::time_point> in_flight;
+    std::string output, input;
+    std::vector<char> buffer(1 << 16);
+    size_t next = 0;
+
+    while (next < requests.size() || !in_flight.empty()) {
+        output.clear();
+        auto now = Clock::now();
+        while (next < requests.size() && in_flight.size() < options.depth) {
+            const auto& req = requests[next++];
+            if (options.binary)
+                server::appendFrame(output, req);
+            else
+                server::appendText(output, req);
+
+            if (req.type == workload::query_request)
+                in_flight.push_back(now);
+        }
+
+        if (!writeAll(fd, output)) {
+            close(fd);
+            return result;
+        }
+        if (in_flight.empty())
+            continue;
+
+        ssize_t bytes = read(fd, buffer.data(), buffer.size());
+        if (bytes <= 0) {
+            close(fd);
+            return result;
+        }
+        input.append(buffer.data(), static_cast<size_t>(bytes));
+
+        auto received = Clock::now();
+        std::string_view pending = input;
+        std::optional<uint64_t> count;
+        while (!in_flight.empty() && server::parseAnswer(pending, options.binary, count)) {
+            result.latencies.push_back(std::chrono::duration<double, std::micro>(received - in_flight.front()).count());
+            in_flight.pop_front();
+            result.errors += !count;
+        }
+        input.erase(0, input.size() - pending.size());
+    }
+
+    close(fd);
+    result.requests = requests.size();
+    result.ok = true;
+    return result;
+}
+
+double percentile(const std::vector<double>& sorted, double share) {
+    if (sorted.empty())
+        return 0;
+    auto index = static_cast<size_t>(share * static_cast<double>(sorted.size() - 1));
+    return sorted[index];
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    options.config.operations = 200000;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string_view option = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("missing value for " + std::string(option));
+                return argv[++i];
+            };
+
+            if      (option == "--unix")          options.unix_path           = value();
+            else if (option == "--tcp")           options.tcp_port            = std::stoi(value());
+            else if (option == "--connections")   options.connections         = std::stoull(value());
+            else if (option == "--ops")           options.config.operations   = std::stoull(value());
+            else if (option == "--depth")         options.depth               = std::max<size_t>(1, std::stoull(value()));
+            else if (option == "--insert-ratio")  options.config.insert_ratio = std::stod(value());
+            else if (option == "--distribution")  options.config.distribution = workload::parseDistribution(value());
+            else if (option == "--min")           options.config.min_key      = std::stoi(value());
+            else if (option == "--max")           options.config.max_key      = std::stoi(value());
+            else if (option == "--range-width")   options.config.range_width  = std::stoll(value());
+            else if (option == "--seed")          options.config.seed         = std::stoull(value());
+            else if (option == "--binary")        options.binary = true;
+            else                                  throw std::invalid_argument("unknown option " + std::string(option));
+        }
+    }
+    catch (const std::exception& error) {
+        std::cerr << error.what() << "\n";
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    if (options.unix_path.empty() == (options.tcp_port < 0)) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::vector<workload::Request>> requests(options.connections);
+    for (size_t i = 0; i < options.connections; ++i) {
+        workload::Config config = options.config;
+        config.seed += i;
+        requests[i] = workload::generate(config);
+    }
+
+    std::vector<ConnectionResult> results(options.connections);
+    std::vector<std::thread> clients;
+
+    auto begin = Clock::now();
+    for (size_t i = 0; i < options.connections; ++i)
+        clients.emplace_back([&, i] { results[i] = runConnection(options, requests[i]); });
+    for (auto& client : clients)
+        client.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+    size_t total = 0, errors = 0;
+    std::vector<double> latencies;
+    for (const auto& result : results) {
+        if (!result.ok) {
+            std::cerr << "connection failed\n";
+            return EXIT_FAILURE;
+        }
+        total += result.requests;
+        errors += result.errors;
+        latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "connections:  " << options.connections << "\n"
+              << "requests:     " << total << " (" << latencies.size() << " queries, " << errors << " errors)\n"
+              << "wall time:    " << seconds << " s\n"
+              << "throughput:   " << static_cast<double>(total) / seconds << " requests/s\n"
+              << "latency p50:  " << percentile(latencies, 0.5) << " us\n"
+              << "latency p99:  " << percentile(latencies, 0.99) << " us\n"
+              << "latency p999: " << percentile(latencies, 0.999) << " us\n"
+              << "latency max:  " << (latencies.empty() ? 0.0 : latencies.back()) << " us\n";
+
+    return EXIT_SUCCESS;
+}
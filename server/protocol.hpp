@@ -0,0 +1,177 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "workload.hpp"
+
+namespace server {
+
+// A connection starting with BINARY_MAGIC speaks the binary framing, any other the text protocol.
+//   text:   one "k KEY", "q FIRST SECOND" or "w KEY" per line; every query is answered with "COUNT\n",
+//           every malformed line with "ERROR\n"
+//   binary: frames of a uint32 payload length followed by the payload, host byte order;
+//           request payload is {char type, int32 first[, int32 second]}, answer payload a uint64 count
+static constexpr char BINARY_MAGIC[4] = {'A', 'V', 'L', 'B'};
+static constexpr size_t MAX_LINE = 128;
+
+static constexpr char error_request = '!'; // malformed text line, answered in request order
+
+enum class ParseStatus {
+    request,
+    incomplete,
+    malformed,
+    overlong    // text line past MAX_LINE with no newline yet; nothing consumed but blank lines
+};
+
+using workload::Request;
+
+inline bool parseKey(std::string_view& text, int32_t& key) {
+    size_t start = text.find_first_not_of(" \t");
+    if (start == std::string_view::npos)
+        return false;
+
+    auto [end, error] = std::from_chars(text.data() + start, text.data() + text.size(), key);
+    if (error != std::errc{})
+        return false;
+
+    text.remove_prefix(static_cast<size_t>(end - text.data()));
+    return true;
+}
+
+// Consumes one request line from the front of `input`.
+inline ParseStatus parseText(std::string_view& input, Request& req) {
+    while (true) {
+        size_t newline = input.find('\n');
+        if (newline == std::string_view::npos)
+            return input.size() > MAX_LINE ? ParseStatus::overlong : ParseStatus::incomplete;
+
+        std::string_view line = input.substr(0, newline);
+        input.remove_prefix(newline + 1);
+
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string_view::npos)
+            continue;
+        line.remove_prefix(start);
+
+        req = {line.front(), 0, 0};
+        line.remove_prefix(1);
+
+        bool parsed = false;
+        if (req.type == workload::key_request || req.type == workload::window_request)
+            parsed = parseKey(line, req.first);
+        else if (req.type == workload::query_request)
+            parsed = parseKey(line, req.first) && parseKey(line, req.second);
+
+        if (!parsed || line.find_first_not_of(" \t") != std::string_view::npos)
+            return ParseStatus::malformed;
+        return ParseStatus::request;
+    }
+}
+
+// Consumes one frame from the front of `input`.
+inline ParseStatus parseFrame(std::string_view& input, Request& req) {
+    uint32_t length;
+    if (input.size() < sizeof(length))
+        return ParseStatus::incomplete;
+    std::memcpy(&length, input.data(), sizeof(length));
+
+    if (length != 1 + sizeof(int32_t) && length != 1 + 2 * sizeof(int32_t))
+        return ParseStatus::malformed;
+    if (input.size() < sizeof(length) + length)
+        return ParseStatus::incomplete;
+
+    const char* payload = input.data() + sizeof(length);
+    req = {payload[0], 0, 0};
+    std::memcpy(&req.first, payload + 1, sizeof(int32_t));
+
+    bool pair = req.type == workload::query_request;
+    if (pair)
+        std::memcpy(&req.second, payload + 1 + sizeof(int32_t), sizeof(int32_t));
+
+    input.remove_prefix(sizeof(length) + length);
+
+    if (pair != (length == 1 + 2 * sizeof(int32_t)))
+        return ParseStatus::malformed;
+    if (!pair && req.type != workload::key_request && req.type != workload::window_request)
+        return ParseStatus::malformed;
+    return ParseStatus::request;
+}
+
+inline void appendFrame(std::string& output, const Request& req) {
+    bool pair = req.type == workload::query_request;
+    auto length = static_cast<uint32_t>(1 + (pair ? 2 : 1) * sizeof(int32_t));
+
+    output.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    output.push_back(req.type);
+    output.append(reinterpret_cast<const char*>(&req.first), sizeof(int32_t));
+    if (pair)
+        output.append(reinterpret_cast<const char*>(&req.second), sizeof(int32_t));
+}
+
+inline void appendText(std::string& output, const Request& req) {
+    auto appendKey = [&output](int32_t key) {
+        char buffer[12];
+        output.push_back(' ');
+        output.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), key).ptr);
+    };
+
+    output.push_back(req.type);
+    appendKey(req.first);
+    if (req.type == workload::query_request)
+        appendKey(req.second);
+    output.push_back('\n');
+}
+
+inline void appendAnswer(std::string& output, bool binary, std::optional<uint64_t> count) {
+    if (binary) {
+        uint32_t length = sizeof(uint64_t);
+        uint64_t value = count.value_or(0);
+        output.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        output.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        return;
+    }
+
+    if (!count) {
+        output.append("ERROR\n");
+        return;
+    }
+
+    char buffer[24];
+    char* cursor = std::to_chars(buffer, buffer + sizeof(buffer), *count).ptr;
+    *cursor++ = '\n';
+    output.append(buffer, cursor);
+}
+
+// Consumes one answer from the front of `input`, false while it is incomplete.
+// A text "ERROR" line leaves `count` empty.
+inline bool parseAnswer(std::string_view& input, bool binary, std::optional<uint64_t>& count) {
+    if (binary) {
+        if (input.size() < sizeof(uint32_t) + sizeof(uint64_t))
+            return false;
+
+        uint64_t value;
+        std::memcpy(&value, input.data() + sizeof(uint32_t), sizeof(value));
+        input.remove_prefix(sizeof(uint32_t) + sizeof(uint64_t));
+        count = value;
+        return true;
+    }
+
+    size_t newline = input.find('\n');
+    if (newline == std::string_view::npos)
+        return false;
+
+    uint64_t value = 0;
+    auto [end, error] = std::from_chars(input.data(), input.data() + newline, value);
+    count = error == std::errc{} && end == input.data() + newline ? std::optional<uint64_t>(value) : std::nullopt;
+    input.remove_prefix(newline + 1);
+    return true;
+}
+
+} // namespace server
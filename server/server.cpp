@@ -0,0 +1,527 @@
+#include "protocol.hpp"
+#include "sliding_window.hpp"
+#include "spsc_ring.hpp"
+
+#include <atomic>
+#include <charconv>
+#include <cerrno>
+#include <csignal>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t RING_SIZE   = 64;
+constexpr size_t READ_CHUNK  = 1 << 16;
+constexpr int    MAX_EVENTS  = 256;
+constexpr size_t MAX_PENDING = 1 << 16; // parsed requests held back before connections stop being read
+
+struct TaggedRequest {
+    uint64_t connection;
+    server::Request req;
+};
+
+struct RequestBatch {
+    std::vector<TaggedRequest> requests;
+    bool last = false;
+};
+
+struct Answer {
+    uint64_t connection;
+    std::optional<uint64_t> count;
+};
+
+using RequestRing = avl::spsc_ring<RequestBatch, RING_SIZE>;
+using AnswerRing  = avl::spsc_ring<std::vector<Answer>, RING_SIZE>;
+
+enum class Framing {
+    unknown,
+    text,
+    binary
+};
+
+struct Connection {
+    int fd = -1;
+    Framing framing = Framing::unknown;
+    std::string input;
+    std::string output;
+    size_t awaiting = 0;  // queries and errors not answered yet
+    bool writing = false; // EPOLLOUT registered
+    bool closing = false; // peer finished sending, close once everything is answered
+    bool discarding = false; // rest of an over-long text line, already answered with one ERROR
+};
+
+void printUsage() {
+    std::cerr << "usage: avl_server (--unix PATH | --tcp PORT)\n"
+                 "  --unix PATH   listen on a Unix-domain socket\n"
+                 "  --tcp PORT    listen on 127.0.0.1:PORT\n";
+}
+
+// 1-65535, 0 for anything else
+int parsePort(std::string_view text) {
+    int port = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), port);
+    if (error != std::errc{} || end != text.data() + text.size() || port < 1 || port > 65535)
+        return 0;
+    return port;
+}
+
+void wake(int fd) {
+    uint64_t one = 1;
+    [[maybe_unused]] ssize_t written = write(fd, &one, sizeof(one));
+}
+
+void drainWakeups(int fd) {
+    uint64_t count;
+    [[maybe_unused]] ssize_t bytes = read(fd, &count, sizeof(count));
+}
+
+// The only thread touching the tree: applies every batch in arrival order and
+// hands the query answers back to the event loop.
+void applyBatches(RequestRing& requests, AnswerRing& answers, int work_fd, int answer_fd) {
+    avl::sliding_window<int> tree;
+
+    while (true) {
+        RequestBatch batch;
+        if (!requests.try_pop(batch)) {
+            drainWakeups(work_fd);
+            continue;
+        }
+
+        std::vector<Answer> result;
+        for (const auto& [connection, req] : batch.requests) {
+            if (req.type == workload::key_request)
+                tree.insert(req.first);
+            else if (req.type == workload::window_request)
+                tree.expire_before(req.first);
+            else if (req.type == workload::query_request)
+                result.push_back({connection, tree.range_queries(req.first, req.second)});
+            else
+                result.push_back({connection, std::nullopt});
+        }
+
+        if (!result.empty()) {
+            answers.push(std::move(result));
+            wake(answer_fd);
+        }
+
+        if (batch.last)
+            return;
+    }
+}
+
+int listenUnix(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+
+    path.copy(address.sun_path, path.size());
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int listenTcp(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+
+    int enable = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Single-threaded epoll loop: reads and parses every ready connection, then forwards all
+// requests gathered in one wakeup as a single batch, so queries from different clients
+// reach the tree together.
+class EventLoop final {
+ private:
+    int epoll_fd_;
+    int listen_fd_;
+    int signal_fd_;
+    int work_fd_;
+    int answer_fd_;
+    bool tcp_;
+
+    RequestRing& requests_;
+    AnswerRing& answers_;
+
+    std::unordered_map<int, uint64_t> ids_;                 // fd -> connection id
+    std::unordered_map<uint64_t, Connection> connections_;
+    uint64_t next_id_ = 0;
+    RequestBatch pending_;
+    bool paused_ = false; // EPOLLIN dropped while the tree thread is behind
+
+ public:
+    EventLoop(int listen_fd, int signal_fd, int work_fd, int answer_fd, bool tcp,
+              RequestRing& requests, AnswerRing& answers) :
+        epoll_fd_(epoll_create1(EPOLL_CLOEXEC)), listen_fd_(listen_fd), signal_fd_(signal_fd),
+        work_fd_(work_fd), answer_fd_(answer_fd), tcp_(tcp), requests_(requests), answers_(answers) {
+        for (int fd : {listen_fd_, signal_fd_, answer_fd_})
+            watch(fd, EPOLLIN, EPOLL_CTL_ADD);
+    }
+
+    ~EventLoop() {
+        for (auto& [id, connection] : connections_)
+            close(connection.fd);
+        close(epoll_fd_);
+    }
+
+    void run() {
+        std::vector<epoll_event> events(MAX_EVENTS);
+
+        while (true) {
+            // a batch the tree thread had no room for is retried shortly
+            int timeout = pending_.requests.empty() ? -1 : 1;
+            int ready = epoll_wait(epoll_fd_, events.data(), MAX_EVENTS, timeout);
+            if (ready < 0 && errno != EINTR)
+                break;
+
+            bool stopping = false;
+            for (int i = 0; i < ready; ++i) {
+                int fd = events[static_cast<size_t>(i)].data.fd;
+                uint32_t flags = events[static_cast<size_t>(i)].events;
+
+                if (fd == listen_fd_)
+                    acceptAll();
+                else if (fd == signal_fd_)
+                    stopping = true;
+                else if (fd == answer_fd_)
+                    deliverAnswers();
+                else
+                    serve(fd, flags);
+            }
+
+            if (stopping)
+                break;
+            flushBatch();
+            updateReading();
+        }
+
+        // keep delivering while waiting for room, the tree thread may be blocked on answers
+        pending_.last = true;
+        while (!requests_.try_push(pending_)) {
+            deliverAnswers();
+            std::this_thread::yield();
+        }
+        wake(work_fd_);
+    }
+
+ private:
+    void watch(int fd, uint32_t flags, int operation) {
+        epoll_event event{};
+        event.events = flags;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd_, operation, fd, &event);
+    }
+
+    void acceptAll() {
+        while (true) {
+            int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+                return;
+
+            if (tcp_) {
+                int enable = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+            }
+
+            uint64_t id = next_id_++;
+            ids_[fd] = id;
+            connections_[id].fd = fd;
+            watch(fd, watchFlags(connections_[id]), EPOLL_CTL_ADD);
+        }
+    }
+
+    void serve(int fd, uint32_t flags) {
+        auto found = ids_.find(fd);
+        if (found == ids_.end())
+            return;
+
+        uint64_t id = found->second;
+        Connection& connection = connections_[id];
+
+        if (connection.closing && (flags & (EPOLLHUP | EPOLLERR))) {
+            disconnect(id);
+            return;
+        }
+        if (flags & EPOLLOUT) {
+            flushOutput(id, connection);
+            return;
+        }
+        if (paused_)
+            return;
+
+        size_t old_size = connection.input.size();
+        connection.input.resize(old_size + READ_CHUNK);
+        ssize_t bytes = read(fd, connection.input.data() + old_size, READ_CHUNK);
+        if (bytes <= 0) {
+            connection.input.resize(old_size);
+            if (bytes < 0 && (errno == EAGAIN || errno == EINTR))
+                return;
+            if (bytes < 0) {
+                disconnect(id);
+                return;
+            }
+
+            // half-closed: answer what was already sent, then close
+            connection.closing = true;
+            flushOutput(id, connection);
+            return;
+        }
+        connection.input.resize(old_size + static_cast<size_t>(bytes));
+
+        if (!parseRequests(id, connection))
+            disconnect(id);
+    }
+
+    bool parseRequests(uint64_t id, Connection& connection) {
+        std::string_view input = connection.input;
+
+        if (connection.framing == Framing::unknown) {
+            size_t prefix = std::min(input.size(), sizeof(server::BINARY_MAGIC));
+            if (input.substr(0, prefix) != std::string_view(server::BINARY_MAGIC, prefix)) {
+                connection.framing = Framing::text;
+            }
+            else if (prefix == sizeof(server::BINARY_MAGIC)) {
+                connection.framing = Framing::binary;
+                input.remove_prefix(prefix);
+            }
+            else {
+                return true;
+            }
+        }
+
+        server::Request req;
+        while (true) {
+            if (connection.discarding) {
+                size_t newline = input.find('\n');
+                if (newline == std::string_view::npos) {
+                    input = {};
+                    break;
+                }
+                input.remove_prefix(newline + 1);
+                connection.discarding = false;
+            }
+
+            server::ParseStatus status = connection.framing == Framing::binary
+                                       ? server::parseFrame(input, req)
+                                       : server::parseText(input, req);
+
+            if (status == server::ParseStatus::incomplete)
+                break;
+            if (status == server::ParseStatus::overlong) {
+                // one ERROR now, the rest of the line is dropped up to its newline
+                pending_.requests.push_back({id, {server::error_request, 0, 0}});
+                ++connection.awaiting;
+                connection.discarding = true;
+                input = {};
+                break;
+            }
+            if (status == server::ParseStatus::malformed) {
+                if (connection.framing == Framing::binary)
+                    return false;
+                req.type = server::error_request;
+            }
+            pending_.requests.push_back({id, req});
+            connection.awaiting += req.type == workload::query_request || req.type == server::error_request;
+        }
+
+        connection.input.erase(0, connection.input.size() - input.size());
+        return true;
+    }
+
+    void flushBatch() {
+        if (pending_.requests.empty())
+            return;
+
+        if (requests_.try_push(pending_)) {
+            pending_ = {};
+            wake(work_fd_);
+        }
+    }
+
+    // Stops reading every connection while the parsed backlog is above MAX_PENDING, so a client
+    // that sends faster than the tree applies waits in its socket buffer instead of our memory.
+    void updateReading() {
+        bool pause = pending_.requests.size() >= MAX_PENDING;
+        if (pause == paused_)
+            return;
+
+        paused_ = pause;
+        for (auto& [id, connection] : connections_)
+            watch(connection.fd, watchFlags(connection), EPOLL_CTL_MOD);
+    }
+
+    uint32_t watchFlags(const Connection& connection) const noexcept {
+        // a closing connection is no longer read: it would report EOF forever
+        bool reading = !connection.closing && !paused_;
+        return (reading ? uint32_t{EPOLLIN} : 0) | (connection.writing ? uint32_t{EPOLLOUT} : 0);
+    }
+
+    void deliverAnswers() {
+        drainWakeups(answer_fd_);
+
+        std::vector<Answer> batch;
+        std::vector<uint64_t> touched;
+        while (answers_.try_pop(batch)) {
+            for (const auto& [id, count] : batch) {
+                auto it = connections_.find(id);
+                if (it == connections_.end())
+                    continue;
+
+                Connection& connection = it->second;
+                if (connection.output.empty())
+                    touched.push_back(id);
+                --connection.awaiting;
+                server::appendAnswer(connection.output, connection.framing == Framing::binary, count);
+            }
+        }
+
+        for (uint64_t id : touched) {
+            auto it = connections_.find(id);
+            if (it != connections_.end())
+                flushOutput(id, it->second);
+        }
+    }
+
+    void flushOutput(uint64_t id, Connection& connection) {
+        while (!connection.output.empty()) {
+            ssize_t bytes = write(connection.fd, connection.output.data(), connection.output.size());
+            if (bytes < 0 && errno != EAGAIN && errno != EINTR) {
+                disconnect(id);
+                return;
+            }
+            if (bytes <= 0)
+                break;
+            connection.output.erase(0, static_cast<size_t>(bytes));
+        }
+
+        if (connection.closing && connection.output.empty() && connection.awaiting == 0) {
+            disconnect(id);
+            return;
+        }
+
+        bool writing = !connection.output.empty();
+        if (writing != connection.writing || connection.closing) {
+            connection.writing = writing;
+            watch(connection.fd, watchFlags(connection), EPOLL_CTL_MOD);
+        }
+    }
+
+    void disconnect(uint64_t id) {
+        auto it = connections_.find(id);
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, it->second.fd, nullptr);
+        close(it->second.fd);
+        ids_.erase(it->second.fd);
+        connections_.erase(it);
+    }
+};
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    std::string unix_path;
+    int tcp_port = -1;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string_view option = argv[i];
+        if (option == "--unix")
+            unix_path = argv[i + 1];
+        else if (option == "--tcp")
+            tcp_port = parsePort(argv[i + 1]);
+    }
+
+    if (tcp_port == 0) {
+        std::cerr << "invalid port, expected 1-65535\n";
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    if (unix_path.empty() == (tcp_port < 0) || argc % 2 == 0) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    int listen_fd = unix_path.empty() ? listenTcp(static_cast<uint16_t>(tcp_port)) : listenUnix(unix_path);
+    if (listen_fd < 0) {
+        std::cerr << "cannot listen on " << (unix_path.empty() ? std::to_string(tcp_port) : unix_path) << "\n";
+        return EXIT_FAILURE;
+    }
+
+    // blocked before any thread starts, so only the signalfd sees them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    int signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    int work_fd   = eventfd(0, EFD_CLOEXEC);
+    int answer_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    auto requests = std::make_unique<RequestRing>();
+    auto answers  = std::make_unique<AnswerRing>();
+
+    std::atomic<bool> finished = false;
+    std::thread writer([&] {
+        applyBatches(*requests, *answers, work_fd, answer_fd);
+        finished = true;
+    });
+
+    {
+        EventLoop loop(listen_fd, signal_fd, work_fd, answer_fd, unix_path.empty(), *requests, *answers);
+        std::cerr << "listening on " << (unix_path.empty() ? "127.0.0.1:" + std::to_string(tcp_port) : unix_path) << "\n";
+        loop.run();
+    }
+
+    // answers to the final batch have nobody left to read them
+    std::vector<Answer> discarded;
+    while (!finished) {
+        while (answers->try_pop(discarded)) {}
+        std::this_thread::yield();
+    }
+    writer.join();
+
+    for (int fd : {listen_fd, signal_fd, work_fd, answer_fd})
+        close(fd);
+    if (!unix_path.empty())
+        unlink(unix_path.c_str());
+
+    return EXIT_SUCCESS;
+}
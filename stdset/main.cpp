@@ -1,9 +1,11 @@
 #include <iostream>
 #include <set>
+#include <optional>
 
 namespace {
-    const char key_request   = 'k';
-    const char query_request = 'q';
+    const char key_request    = 'k';
+    const char query_request  = 'q';
+    const char window_request = 'w';
 } // anonymous namespace
 
 
@@ -20,6 +22,7 @@ size_t range_queries(const SetType& set, const KeyType& first, const KeyType& se
 
 int main() {
     std::set<int> tree;
+    std::optional<int> horizon;
     char request;
 
     while (std::cin >> request) {
@@ -29,7 +32,8 @@ int main() {
                 std::cerr << "WRONG GIVEN KEY\n";
                 return EXIT_FAILURE;
             }
-            tree.insert(newKey);
+            if (!horizon || newKey >= *horizon)
+                tree.insert(newKey);
         }
         else if (request == query_request) {
             int first, second;
@@ -39,6 +43,17 @@ int main() {
             }
            std::cout << range_queries(tree, first, second) << " ";
         }
+        else if (request == window_request) {
+            int newHorizon;
+            if (!(std::cin >> newHorizon)) {
+                std::cerr << "WRONG GIVEN HORIZON\n";
+                return EXIT_FAILURE;
+            }
+            if (!horizon || newHorizon > *horizon) {
+                horizon = newHorizon;
+                tree.erase(tree.begin(), tree.lower_bound(newHorizon));
+            }
+        }
         else {
             std::cerr << "WRONG REQUEST -> " << request << "\n";
             return EXIT_FAILURE;
@@ -1,13 +1,18 @@
 import subprocess
 import glob
 import os
+import sys
 
 avl = "../../build/avltree/./avltree"
 
+# every other driver mode must print exactly what the serial driver printed
+modes = ["--pipelined", "--offline", "--cached"]
+
 input_dir = "input_files/"
 output_dir = "output_files/"
 
 test_files = sorted(glob.glob(os.path.join(input_dir, "test_*.in")))
+failures = 0
 
 for file in test_files:
     base = os.path.basename(file)
@@ -23,5 +28,22 @@ for file in test_files:
         )
         if run.returncode != 0:
             fout.write(f"ERROR: {run.stderr}\n")
+            failures += 1
+            continue
         else:
             fout.write(run.stdout)
+
+    for mode in modes:
+        with open(file, "r") as fin:
+            run_mode = subprocess.run(
+                [avl, mode],
+                stdin=fin,
+                text=True,
+                capture_output=True
+            )
+        if run_mode.returncode != 0 or run_mode.stdout != run.stdout:
+            print(f"{base}: {mode} output differs from the serial driver")
+            failures += 1
+
+print(f"{len(test_files)} tests, {len(modes) + 1} driver modes, {failures} failures")
+sys.exit(1 if failures else 0)
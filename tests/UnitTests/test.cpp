@@ -1,6 +1,26 @@
 #include <gtest/gtest.h>
 
 #include "avl_tree.hpp"
+#include "pipeline.hpp"
+#include "offline_engine.hpp"
+#include "compressed_set.hpp"
+#include "sliding_window.hpp"
+#include "range_tree_2d.hpp"
+#include "query_cache.hpp"
+#include "server/protocol.hpp"
+#include "durable_tree.hpp"
+#include "interval_tree.hpp"
+
+#include <set>
+#include <random>
+#include <sstream>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <filesystem>
+#include <fstream>
+#include <bit>
+#include <unistd.h>
 
 TEST(AVL_TREE_FUNCTIONS, range_query_1) {
     avl::avl_tree<int> tree;
@@ -264,6 +284,959 @@ TEST(AVL_ITERATOR, operator_dereference) {
     ASSERT_EQ(tree.begin()->key_, 10);
 }
 
+template <typename Policy>
+class BALANCE_POLICY : public testing::Test {};
+
+using balance_policies = testing::Types<avl::avl_balance, avl::wavl_balance,
+                                        avl::rb_balance, avl::treap_balance>;
+TYPED_TEST_SUITE(BALANCE_POLICY, balance_policies);
+
+template <typename Node>
+size_t checkSubtree(const Node* node, const Node* parent) {
+    if (!node)
+        return 0;
+
+    EXPECT_EQ(node->parent_, parent);
+    size_t depth = 1 + std::max(checkSubtree(node->left_.get(), node),
+                                checkSubtree(node->right_.get(), node));
+
+    size_t size = 1;
+    size += node->left_  ? node->left_->subtree_size_  : 0;
+    size += node->right_ ? node->right_->subtree_size_ : 0;
+    EXPECT_EQ(node->subtree_size_, size);
+
+    return depth;
+}
+
+TYPED_TEST(BALANCE_POLICY, random_against_std_set) {
+    avl::avl_tree<int, TypeParam> tree;
+    std::set<int> reference;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(-5000, 5000);
+
+    for (int i = 0; i < 20000; ++i) {
+        int key = dist(gen);
+        tree.insert(key);
+        reference.insert(key);
+
+        int first = dist(gen), second = dist(gen);
+        size_t expected = first > second ? 0 : std::distance(reference.lower_bound(first),
+                                                             reference.upper_bound(second));
+        ASSERT_EQ(tree.range_queries(first, second), expected);
+    }
+
+    auto it = tree.begin();
+    for (int key : reference) {
+        ASSERT_EQ(it->key_, key);
+        ++it;
+    }
+    ASSERT_TRUE(!it);
+}
+
+TYPED_TEST(BALANCE_POLICY, sequential_insert_stays_shallow) {
+    avl::avl_tree<int, TypeParam> tree;
+    const size_t n = 1 << 16;
+
+    for (size_t i = 0; i < n; ++i)
+        tree.insert(static_cast<int>(i));
+
+    size_t depth = checkSubtree(tree.root.get(), static_cast<decltype(tree.root.get())>(nullptr));
+    ASSERT_EQ(tree.root->subtree_size_, n);
+    ASSERT_LE(depth, 3 * 16); // 2 log n for rb/wavl, expected O(log n) for treap
+}
+
+TYPED_TEST(BALANCE_POLICY, build_from_sorted_then_insert) {
+    std::vector<int> keys;
+    for (int key = 0; key < 6000; key += 2)
+        keys.push_back(key);
+
+    auto tree = avl::avl_tree<int, TypeParam>::build_from_sorted(keys);
+    size_t depth = checkSubtree(tree.root.get(), static_cast<decltype(tree.root.get())>(nullptr));
+    ASSERT_EQ(tree.size(), keys.size());
+    ASSERT_EQ(depth, static_cast<size_t>(std::bit_width(keys.size())));
+
+    std::set<int> reference(keys.begin(), keys.end());
+    std::mt19937 gen(44);
+    std::uniform_int_distribution<int> dist(-1000, 7000);
+
+    for (int i = 0; i < 20000; ++i) {
+        int key = dist(gen);
+        ASSERT_EQ(tree.insert(key), reference.insert(key).second);
+
+        int first = dist(gen), second = dist(gen);
+        size_t expected = first > second ? 0 : std::distance(reference.lower_bound(first),
+                                                             reference.upper_bound(second));
+        ASSERT_EQ(tree.range_queries(first, second), expected);
+    }
+
+    depth = checkSubtree(tree.root.get(), static_cast<decltype(tree.root.get())>(nullptr));
+    ASSERT_LE(depth, 3 * 13);
+    ASSERT_TRUE((avl::avl_tree<int, TypeParam>::build_from_sorted({}).empty()));
+}
+
+TEST(PIPELINE, spsc_ring_keeps_order) {
+    auto ring = std::make_unique<avl::spsc_ring<int, 8>>();
+    const int count = 100000;
+
+    std::thread producer([&ring] {
+        for (int i = 0; i < count; ++i)
+            ring->push(i);
+    });
+
+    for (int i = 0; i < count; ++i)
+        ASSERT_EQ(ring->pop(), i);
+
+    producer.join();
+}
+
+TEST(PIPELINE, matches_serial_answers) {
+    std::string input;
+    avl::avl_tree<int> serial;
+    std::string expected;
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> dist(-1000, 1000);
+
+    for (int i = 0; i < 20000; ++i) {
+        int first = dist(gen), second = dist(gen);
+        if (i % 2) {
+            input += "k " + std::to_string(first) + "\n";
+            serial.insert(first);
+        }
+        else {
+            input += "q " + std::to_string(first) + " " + std::to_string(second) + "\n";
+            expected += std::to_string(serial.range_queries(first, second)) + " ";
+        }
+    }
+    expected += "\n";
+
+    std::FILE* file = fmemopen(input.data(), input.size(), "r");
+    ASSERT_NE(file, nullptr);
+
+    avl::avl_tree<int> tree;
+    std::ostringstream output;
+    avl::pipeline::run<avl::avl_tree<int>, int>(tree, file, output);
+    std::fclose(file);
+
+    ASSERT_EQ(output.str(), expected);
+}
+
+TEST(PIPELINE, malformed_keys_are_read_again_from_next_line) {
+    std::string input = "k 1\nk x\n5\nq 0\n3 7\nz 4\nq 0 10\n";
+    std::FILE* file = fmemopen(input.data(), input.size(), "r");
+    ASSERT_NE(file, nullptr);
+
+    avl::avl_tree<int> tree;
+    std::ostringstream output;
+    std::streambuf* errors = std::cerr.rdbuf(nullptr);
+    avl::pipeline::run<avl::avl_tree<int>, int>(tree, file, output);
+    std::cerr.rdbuf(errors);
+    std::fclose(file);
+
+    ASSERT_EQ(output.str(), "1 2 \n"); // "q 0" takes 3 from the next line, "7" is an unknown request
+}
+
+TEST(OFFLINE_ENGINE, matches_online_tree) {
+    std::vector<avl::request<int>> requests;
+    std::vector<size_t> expected;
+    avl::avl_tree<int> tree;
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<int> dist(-3000, 3000);
+
+    for (int i = 0; i < 30000; ++i) {
+        int first = dist(gen), second = dist(gen);
+        if (gen() % 3 == 0) {
+            requests.push_back({avl::key_request, first, 0});
+            tree.insert(first);
+        }
+        else {
+            requests.push_back({avl::query_request, first, second});
+            expected.push_back(tree.range_queries(first, second));
+        }
+    }
+
+    ASSERT_EQ(avl::offline::answer(requests), expected);
+}
+
+TEST(OFFLINE_ENGINE, queries_before_any_insert) {
+    std::vector<avl::request<int>> requests = {
+        {avl::query_request, 0, 10}, {avl::key_request, 5, 0}, {avl::key_request, 5, 0},
+        {avl::query_request, 0, 10}, {avl::query_request, 10, 0}, {avl::query_request, 6, 9}
+    };
+
+    std::vector<size_t> expected = {0, 1, 0, 0};
+    ASSERT_EQ(avl::offline::answer(requests), expected);
+}
+
+TEST(BATCHED_LOOKUP, matches_sequential) {
+    avl::avl_tree<int> tree;
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<int> dist(-20000, 20000);
+
+    for (int i = 0; i < 10000; ++i)
+        tree.insert(dist(gen));
+
+    std::vector<int> keys(5000);
+    for (auto& key : keys)
+        key = dist(gen);
+
+    using iterator = avl::avl_tree<int>::iterator;
+    std::vector<iterator> found(keys.size());
+    std::vector<iterator> lower(keys.size());
+    std::vector<size_t> ranks(keys.size());
+
+    tree.find_batch(keys, found, 7);
+    tree.lower_bound_batch(keys, lower);
+    tree.rank_batch(keys, ranks, avl::MAX_LOOKUP_GROUP);
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        auto [node, flag] = tree.find(keys[i]);
+        ASSERT_EQ(found[i], iterator(flag == avl::FindFlags::exists ? node : nullptr));
+        ASSERT_EQ(lower[i], tree.lower_bound(keys[i]));
+        ASSERT_EQ(ranks[i], tree.range_queries(std::numeric_limits<int>::min(), keys[i] - 1));
+    }
+}
+
+TEST(BATCHED_LOOKUP, empty_tree) {
+    avl::avl_tree<int> tree;
+    std::vector<int> keys = {1, 2, 3};
+    std::vector<size_t> ranks(keys.size(), 42);
+
+    tree.rank_batch(keys, ranks);
+    ASSERT_EQ(ranks, std::vector<size_t>(keys.size(), 0));
+    ASSERT_EQ(tree.size(), 0);
+}
+
+static_assert(std::ranges::forward_range<avl::avl_tree<int>::range_view>);
+static_assert(std::ranges::sized_range<avl::avl_tree<int>::range_view>);
+static_assert(std::ranges::view<avl::avl_tree<int>::range_view>);
+
+TEST(RANGE_VIEW, keys_and_size) {
+    avl::avl_tree<int> tree;
+    for (int key : {9, -3, 79, -5, 0, -1, 10, 2, 8})
+        tree.insert(key);
+
+    auto view = tree.range(-1, 9);
+    ASSERT_EQ(view.size(), 5);
+
+    std::vector<int> keys(view.begin(), view.end());
+    ASSERT_EQ(keys, std::vector<int>({-1, 0, 2, 8, 9}));
+
+    ASSERT_TRUE(tree.range(11, 78).empty());
+    ASSERT_TRUE(tree.range(5, 1).empty());
+    ASSERT_EQ(std::ranges::distance(tree.range(-100, 100)), 9);
+}
+
+TEST(RANGE_VIEW, copy_range) {
+    avl::avl_tree<int> tree;
+    std::set<int> reference;
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<int> dist(-1000, 1000);
+
+    for (int i = 0; i < 3000; ++i) {
+        int key = dist(gen);
+        tree.insert(key);
+        reference.insert(key);
+    }
+
+    for (int i = 0; i < 200; ++i) {
+        int first = dist(gen), second = dist(gen);
+        std::vector<int> keys;
+        tree.copy_range(first, second, keys);
+
+        std::vector<int> expected;
+        if (first <= second)
+            expected.assign(reference.lower_bound(first), reference.upper_bound(second));
+
+        ASSERT_EQ(keys, expected);
+        ASSERT_TRUE(std::ranges::equal(tree.range(first, second), expected));
+    }
+}
+
+TEST(RANGE_VIEW, for_each_in_range_threads) {
+    avl::avl_tree<int> tree;
+    for (int key = 0; key < 100000; ++key)
+        tree.insert(key);
+
+    std::atomic<long long> sum = 0;
+    std::atomic<size_t> count = 0;
+    tree.for_each_in_range(100, 90000, [&](int key) {
+        sum += key;
+        ++count;
+    }, 4);
+
+    ASSERT_EQ(count, 89901);
+    ASSERT_EQ(sum, (100LL + 90000) * 89901 / 2);
+
+    std::vector<int> ordered;
+    tree.for_each_in_range(5, 9, [&](int key) { ordered.push_back(key); });
+    ASSERT_EQ(ordered, std::vector<int>({5, 6, 7, 8, 9}));
+}
+
+TEST(COMPACTION, in_order_layout) {
+    avl::avl_tree<int> tree;
+    std::mt19937 gen(9);
+    std::uniform_int_distribution<int> dist(-100000, 100000);
+    for (int i = 0; i < 20000; ++i)
+        tree.insert(dist(gen));
+
+    avl::avl_tree<int> reference{tree};
+    auto before = tree.memory_usage();
+    ASSERT_EQ(before.heap_nodes, tree.size());
+    ASSERT_EQ(before.block_bytes, 0);
+
+    tree.compact();
+
+    auto after = tree.memory_usage();
+    ASSERT_EQ(after.heap_nodes, 0);
+    ASSERT_EQ(after.allocator_overhead, 0);
+    ASSERT_EQ(after.unused_block_bytes, 0);
+    ASSERT_LT(after.total(), before.total());
+
+    checkSubtree(tree.root.get(), static_cast<decltype(tree.root.get())>(nullptr));
+
+    const auto* previous = &*tree.begin();
+    for (auto it = ++tree.begin(); it != tree.end(); ++it) {
+        ASSERT_EQ(it.operator->(), previous + 1); // consecutive keys are adjacent in memory
+        previous = it.operator->();
+    }
+
+    for (int i = 0; i < 2000; ++i) {
+        int first = dist(gen), second = dist(gen);
+        ASSERT_EQ(tree.range_queries(first, second), reference.range_queries(first, second));
+    }
+}
+
+TEST(COMPACTION, node_size) {
+    // key, balance data, subtree size with the pooled bit, parent and two pointer-sized links
+    ASSERT_EQ(avl::avl_tree<int>{}.memory_usage().node_size, 6 * sizeof(void*));
+    ASSERT_EQ(avl::avl_tree<long long>{}.memory_usage().node_size, 6 * sizeof(void*));
+}
+
+TEST(COMPACTION, copy_assignment_releases_block) {
+    avl::avl_tree<int> tree;
+    for (int key = 0; key < 1000; ++key)
+        tree.insert(key);
+    tree.compact();
+
+    avl::avl_tree<int> small;
+    for (int key = 0; key < 10; ++key)
+        small.insert(key);
+
+    tree = small;
+    auto usage = tree.memory_usage();
+    ASSERT_EQ(usage.block_bytes, 0);
+    ASSERT_EQ(usage.heap_nodes, 10);
+    ASSERT_EQ(tree.range_queries(0, 9), 10);
+}
+
+TEST(COMPACTION, breadth_first_then_insert) {
+    avl::avl_tree<int, avl::rb_balance> tree;
+    for (int key = 0; key < 1000; ++key)
+        tree.insert(key * 2);
+
+    tree.compact(avl::CompactOrder::breadth_first);
+    for (auto it = tree.begin(); it != tree.end(); ++it)
+        ASSERT_GE(it.operator->(), tree.root.get()); // root takes the first slot
+
+    for (int key = 0; key < 1000; ++key)
+        tree.insert(key * 2 + 1);
+
+    auto usage = tree.memory_usage();
+    ASSERT_EQ(usage.heap_nodes, 1000);
+    ASSERT_EQ(usage.nodes, 2000);
+    ASSERT_EQ(tree.range_queries(0, 1999), 2000);
+
+    checkSubtree(tree.root.get(), static_cast<decltype(tree.root.get())>(nullptr));
+
+    avl::avl_tree<int, avl::rb_balance> moved{std::move(tree)};
+    ASSERT_EQ(moved.range_queries(100, 199), 100);
+}
+
+TEST(COMPRESSED_SET, random_against_std_set) {
+    avl::compressed_set<long long> tree;
+    std::set<long long> reference;
+    std::mt19937_64 gen(13);
+    std::uniform_int_distribution<long long> dist(-50000, 50000);
+
+    for (int i = 0; i < 60000; ++i) {
+        long long key = dist(gen);
+        ASSERT_EQ(tree.insert(key), reference.insert(key).second);
+
+        if (i % 16 == 0) {
+            long long first = dist(gen), second = dist(gen);
+            size_t expected = first > second ? 0 : std::distance(reference.lower_bound(first),
+                                                                 reference.upper_bound(second));
+            ASSERT_EQ(tree.range_queries(first, second), expected);
+        }
+    }
+
+    ASSERT_EQ(tree.size(), reference.size());
+    ASSERT_TRUE(tree.contains(*reference.begin()));
+    ASSERT_FALSE(tree.contains(50001));
+}
+
+TEST(COMPRESSED_SET, extreme_keys) {
+    avl::compressed_set<int64_t> tree;
+    const int64_t min = std::numeric_limits<int64_t>::min();
+    const int64_t max = std::numeric_limits<int64_t>::max();
+
+    for (int64_t key : {max, min, int64_t{0}, max - 1, min + 1})
+        tree.insert(key);
+
+    ASSERT_EQ(tree.range_queries(min, max), 5);
+    ASSERT_EQ(tree.range_queries(min + 1, max - 1), 3);
+    ASSERT_EQ(tree.range_queries(1, max), 2);
+}
+
+TEST(COMPRESSED_SET, dense_keys_take_under_two_bytes) {
+    avl::compressed_set<int64_t> tree;
+    std::mt19937_64 gen(17);
+    std::vector<int64_t> keys(1 << 18);
+    for (size_t i = 0; i < keys.size(); ++i)
+        keys[i] = 1000000000000LL + static_cast<int64_t>(i) * 3 + static_cast<int64_t>(gen() % 3);
+    std::shuffle(keys.begin(), keys.end(), gen);
+
+    for (int64_t key : keys)
+        tree.insert(key);
+
+    ASSERT_EQ(tree.size(), keys.size());
+    ASSERT_LT(static_cast<double>(tree.memory_usage()) / static_cast<double>(tree.size()), 2.0);
+}
+
+TEST(PARALLEL_ALGORITHMS, reduce_and_count_if) {
+    avl::avl_tree<int, avl::wavl_balance> tree;
+    std::mt19937 gen(19);
+    std::uniform_int_distribution<int> dist(-100000, 100000);
+    std::set<int> reference;
+
+    for (int i = 0; i < 50000; ++i) {
+        int key = dist(gen);
+        tree.insert(key);
+        reference.insert(key);
+    }
+
+    auto is_even = [](int key) { return key % 2 == 0; };
+    auto square  = [](int key) { return static_cast<long long>(key) * key; };
+
+    for (size_t threads : {1, 3, 8}) {
+        ASSERT_EQ(tree.parallel_count_if(is_even, threads),
+                  static_cast<size_t>(std::count_if(reference.begin(), reference.end(), is_even)));
+
+        long long expected = 0;
+        for (int key : reference)
+            expected += square(key);
+        ASSERT_EQ(tree.parallel_reduce(0LL, square, std::plus<long long>(), threads), expected);
+
+        auto lower = reference.lower_bound(-500), upper = reference.upper_bound(777);
+        ASSERT_EQ(tree.parallel_count_if(-500, 777, is_even, threads),
+                  static_cast<size_t>(std::count_if(lower, upper, is_even)));
+    }
+}
+
+TEST(PARALLEL_ALGORITHMS, reduce_keeps_order) {
+    avl::avl_tree<int> tree;
+    for (int key = 0; key < 2000; ++key)
+        tree.insert(key);
+
+    auto concat = [](std::string result, const std::string& part) { return result + part; };
+    auto to_text = [](int key) { return std::to_string(key) + ","; };
+
+    std::string expected;
+    for (int key = 10; key <= 1500; ++key)
+        expected += to_text(key);
+
+    ASSERT_EQ(tree.parallel_reduce(10, 1500, std::string(), to_text, concat, 6), expected);
+
+    std::atomic<size_t> visited = 0;
+    tree.parallel_for_each([&visited](int) { ++visited; }, 4);
+    ASSERT_EQ(visited, tree.size());
+
+    avl::avl_tree<int> empty;
+    ASSERT_EQ(empty.parallel_count_if([](int) { return true; }, 4), 0);
+}
+
+template <typename Node>
+void checkAvlBalance(const Node* node) {
+    if (!node)
+        return;
+
+    size_t left  = node->left_  ? node->left_->height_  : 0;
+    size_t right = node->right_ ? node->right_->height_ : 0;
+    ASSERT_EQ(node->height_, 1 + std::max(left, right));
+    ASSERT_LE(std::max(left, right) - std::min(left, right), 1);
+
+    checkAvlBalance(node->left_.get());
+    checkAvlBalance(node->right_.get());
+}
+
+TEST(SLIDING_WINDOW, split_before_keeps_both_trees_valid) {
+    std::mt19937 gen(23);
+    std::uniform_int_distribution<int> dist(0, 100000);
+
+    for (int round = 0; round < 20; ++round) {
+        avl::avl_tree<int> tree;
+        std::set<int> reference;
+        for (int i = 0; i < 3000; ++i) {
+            int key = dist(gen);
+            tree.insert(key);
+            reference.insert(key);
+        }
+        if (round % 2)
+            tree.compact();
+
+        int pivot = dist(gen);
+        avl::avl_tree<int> less = tree.split_before(pivot);
+
+        size_t expected_less = std::distance(reference.begin(), reference.lower_bound(pivot));
+        ASSERT_EQ(less.size(), expected_less);
+        ASSERT_EQ(tree.size(), reference.size() - expected_less);
+
+        for (const auto* part : {&less, &tree}) {
+            checkSubtree(part->root.get(), static_cast<decltype(part->root.get())>(nullptr));
+            checkAvlBalance(part->root.get());
+        }
+
+        if (!tree.empty()) {
+            ASSERT_GE(tree.begin()->key_, pivot);
+        }
+        ASSERT_EQ(tree.range_queries(0, 100000), reference.size() - expected_less);
+
+        tree.insert(pivot - 1);
+        ASSERT_EQ(tree.begin()->key_, pivot - 1);
+    }
+}
+
+TEST(SLIDING_WINDOW, split_block_is_counted_once) {
+    avl::avl_tree<int> tree;
+    for (int key = 0; key < 1000; ++key)
+        tree.insert(key);
+    tree.compact();
+    size_t block = tree.memory_usage().block_bytes;
+
+    {
+        avl::avl_tree<int> less = tree.split_before(500);
+        for (const auto* part : {&less, &tree}) {
+            auto usage = part->memory_usage();
+            ASSERT_EQ(usage.block_bytes, 0);
+            ASSERT_EQ(usage.unused_block_bytes, 0);
+            ASSERT_EQ(usage.shared_block_bytes, block);
+        }
+    }
+
+    auto usage = tree.memory_usage();
+    ASSERT_EQ(usage.block_bytes, block);
+    ASSERT_EQ(usage.unused_block_bytes, block / 2);
+    ASSERT_EQ(usage.shared_block_bytes, 0);
+}
+
+TEST(SLIDING_WINDOW, expire_matches_std_set) {
+    avl::sliding_window<int> window;
+    std::set<int> reference;
+    std::mt19937 gen(29);
+    int now = 0;
+
+    for (int i = 0; i < 40000; ++i) {
+        now += static_cast<int>(gen() % 3);
+        int key = now - static_cast<int>(gen() % 500);
+        window.insert(key);
+        if (!window.horizon() || key >= *window.horizon())
+            reference.insert(key);
+
+        if (i % 100 == 99) {
+            window.expire_before(now - 300);
+            reference.erase(reference.begin(), reference.lower_bound(now - 300));
+        }
+
+        int first = now - static_cast<int>(gen() % 1000);
+        int second = first + static_cast<int>(gen() % 400);
+        ASSERT_EQ(window.range_queries(first, second),
+                  static_cast<size_t>(std::distance(reference.lower_bound(first), reference.upper_bound(second))));
+    }
+
+    ASSERT_EQ(window.size(), reference.size());
+}
+
+TEST(SLIDING_WINDOW, drivers_agree_on_window_requests) {
+    std::vector<avl::request<int>> requests = {
+        {avl::key_request, 1, 0}, {avl::key_request, 5, 0}, {avl::key_request, 9, 0},
+        {avl::query_request, 0, 10}, {avl::window_request, 5, 0}, {avl::query_request, 0, 10},
+        {avl::key_request, 2, 0}, {avl::key_request, 7, 0}, {avl::query_request, 0, 10},
+        {avl::window_request, 3, 0}, {avl::query_request, 0, 10}
+    };
+    std::vector<size_t> expected = {3, 2, 3, 3};
+    ASSERT_EQ(avl::offline::answer(requests), expected);
+
+    std::string input = "k 1\nk 5\nk 9\nq 0 10\nw 5\nq 0 10\nk 2\nk 7\nq 0 10\nw 3\nq 0 10\n";
+    std::FILE* file = fmemopen(input.data(), input.size(), "r");
+    ASSERT_NE(file, nullptr);
+
+    avl::sliding_window<int> window;
+    std::ostringstream output;
+    avl::pipeline::run<avl::sliding_window<int>, int>(window, file, output);
+    std::fclose(file);
+
+    ASSERT_EQ(output.str(), "3 2 3 3 \n");
+}
+
+static size_t bruteRectangleCount(const std::set<std::pair<int, int>>& points, int x1, int x2, int y1, int y2) {
+    size_t count = 0;
+    for (const auto& [x, y] : points)
+        count += x1 <= x && x <= x2 && y1 <= y && y <= y2;
+    return count;
+}
+
+TEST(RANGE_TREE_2D, dynamic_against_brute_force) {
+    avl::range_tree_2d<int> tree;
+    std::set<std::pair<int, int>> reference;
+    std::mt19937 gen(21);
+    std::uniform_int_distribution<int> dist(-300, 300);
+
+    for (int i = 0; i < 5000; ++i) {
+        int x = dist(gen), y = dist(gen);
+        ASSERT_EQ(tree.insert(x, y), reference.insert({x, y}).second);
+
+        if (i % 25 == 0) {
+            int x1 = dist(gen), x2 = dist(gen), y1 = dist(gen), y2 = dist(gen);
+            ASSERT_EQ(tree.count(x1, x2, y1, y2), bruteRectangleCount(reference, x1, x2, y1, y2));
+        }
+    }
+
+    ASSERT_EQ(tree.size(), reference.size());
+    ASSERT_EQ(tree.count(-300, 300, -300, 300), reference.size());
+}
+
+TEST(RANGE_TREE_2D, static_build_then_insert) {
+    std::vector<std::pair<int, int>> points = {{1, 1}, {2, 5}, {2, 5}, {3, 3}, {5, 1}, {5, 9}, {8, 4}};
+    avl::range_tree_2d<int> tree(points);
+
+    ASSERT_EQ(tree.size(), 6);
+    ASSERT_EQ(tree.count(2, 5, 1, 5), 3);
+    ASSERT_EQ(tree.count(0, 10, 4, 4), 1);
+    ASSERT_EQ(tree.count(6, 7, 0, 10), 0);
+    ASSERT_EQ(tree.count(5, 2, 0, 10), 0);
+
+    ASSERT_FALSE(tree.insert(3, 3));
+    ASSERT_TRUE(tree.insert(4, 4));
+    ASSERT_EQ(tree.count(2, 5, 1, 5), 4);
+}
+
+TEST(RANGE_TREE_2D, static_level_is_not_merged_early) {
+    std::vector<std::pair<int, int>> points;
+    for (int i = 0; i < 10000; ++i)
+        points.push_back({i, (i * 7919) % 10007});
+    avl::range_tree_2d<int> tree(points);
+
+    const size_t capacity = avl::range_tree_2d<int>::BUFFER_CAPACITY;
+    std::vector<size_t> sizes = tree.level_sizes();
+    ASSERT_EQ(sizes.back(), points.size());
+    ASSERT_GE(capacity << (sizes.size() - 1), points.size());
+    ASSERT_LT(capacity << (sizes.size() - 2), points.size());
+
+    for (int i = 0; i < static_cast<int>(capacity); ++i)
+        ASSERT_TRUE(tree.insert(-1 - i, i));
+
+    sizes = tree.level_sizes();
+    ASSERT_EQ(sizes.front(), capacity);
+    ASSERT_EQ(sizes.back(), points.size());
+    ASSERT_EQ(tree.count(-100, 20000, -100, 20000), points.size() + capacity);
+}
+
+TEST(QUERY_CACHE, hot_ranges_against_std_set) {
+    avl::cached_tree<int> tree(avl::range_cache<int>::entryBytes() * 32);
+    std::set<int> reference;
+    std::mt19937 gen(23);
+    std::uniform_int_distribution<int> keys(0, 100000);
+
+    std::vector<std::pair<int, int>> hot(64);
+    for (auto& [first, second] : hot) {
+        first = keys(gen);
+        second = first + keys(gen) / 10;
+    }
+
+    for (int i = 0; i < 40000; ++i) {
+        int key = keys(gen);
+        ASSERT_EQ(tree.insert(key), reference.insert(key).second);
+
+        auto [first, second] = hot[gen() % hot.size()];
+        size_t expected = std::distance(reference.lower_bound(first), reference.upper_bound(second));
+        ASSERT_EQ(tree.range_queries(first, second), expected);
+    }
+
+    const avl::cache_stats& stats = tree.stats();
+    ASSERT_EQ(tree.cache().capacity(), 32);
+    ASSERT_EQ(tree.cache().size(), 32);
+    ASSERT_EQ(stats.hits + stats.misses, 40000);
+    ASSERT_GT(stats.hits, 0);
+    ASSERT_GT(stats.evictions, 0);
+    ASSERT_GT(stats.adjustments, 0);
+}
+
+TEST(QUERY_CACHE, slot_interval_index_against_brute_force) {
+    const size_t slots = 200;
+    avl::slot_interval_index<int> index(slots);
+    std::vector<std::optional<std::pair<int, int>>> ranges(slots);
+    std::mt19937 gen(31);
+    std::uniform_int_distribution<int> dist(0, 1000);
+
+    for (int i = 0; i < 20000; ++i) {
+        size_t slot = gen() % slots;
+        if (ranges[slot])
+            index.erase(slot);
+
+        int first = dist(gen);
+        ranges[slot] = {first, first + dist(gen) / 8};
+        index.insert(slot, ranges[slot]->first, ranges[slot]->second);
+
+        int key = dist(gen);
+        std::vector<size_t> found, expected;
+        index.for_each_containing(key, [&found](size_t hit) { found.push_back(hit); });
+        for (size_t j = 0; j < slots; ++j) {
+            if (ranges[j] && ranges[j]->first <= key && key <= ranges[j]->second)
+                expected.push_back(j);
+        }
+
+        std::sort(found.begin(), found.end());
+        ASSERT_EQ(found, expected);
+    }
+}
+
+TEST(QUERY_CACHE, duplicate_insert_and_expiry) {
+    avl::cached_tree<int, avl::sliding_window<int>> tree;
+
+    for (int key : {1, 4, 6, 9})
+        tree.insert(key);
+    ASSERT_EQ(tree.range_queries(0, 5), 2);
+
+    ASSERT_FALSE(tree.insert(4));
+    ASSERT_EQ(tree.range_queries(0, 5), 2);
+    ASSERT_TRUE(tree.insert(3));
+    ASSERT_EQ(tree.range_queries(0, 5), 3);
+    ASSERT_EQ(tree.stats().hits, 2);
+
+    tree.expire_before(4);
+    ASSERT_EQ(tree.cache().size(), 0);
+    ASSERT_EQ(tree.range_queries(0, 5), 1);
+    ASSERT_FALSE(tree.insert(2));
+    ASSERT_EQ(tree.range_queries(0, 5), 1);
+}
+
+TEST(SERVER_PROTOCOL, text_lines) {
+    std::string_view input = "k 5\n\n  q -3 10\r\nq 1\nw 7\nk 12";
+    server::Request req;
+
+    ASSERT_EQ(server::parseText(input, req), server::ParseStatus::request);
+    ASSERT_EQ(req.type, 'k');
+    ASSERT_EQ(req.first, 5);
+
+    ASSERT_EQ(server::parseText(input, req), server::ParseStatus::request);
+    ASSERT_EQ(req.type, 'q');
+    ASSERT_EQ(req.first, -3);
+    ASSERT_EQ(req.second, 10);
+
+    ASSERT_EQ(server::parseText(input, req), server::ParseStatus::malformed);
+    ASSERT_EQ(server::parseText(input, req), server::ParseStatus::request);
+    ASSERT_EQ(req.type, 'w');
+    ASSERT_EQ(server::parseText(input, req), server::ParseStatus::incomplete);
+    ASSERT_EQ(input, "k 12");
+
+    std::string long_line = "\n\nq 1 " + std::string(server::MAX_LINE, '9');
+    input = long_line;
+    ASSERT_EQ(server::parseText(input, req), server::ParseStatus::overlong);
+    ASSERT_EQ(input.size(), long_line.size() - 2);
+
+    std::string answers;
+    server::appendAnswer(answers, false, 42);
+    server::appendAnswer(answers, false, std::nullopt);
+
+    std::string_view view = answers;
+    std::optional<uint64_t> count;
+    ASSERT_TRUE(server::parseAnswer(view, false, count));
+    ASSERT_EQ(count, 42);
+    ASSERT_TRUE(server::parseAnswer(view, false, count));
+    ASSERT_FALSE(count);
+    ASSERT_FALSE(server::parseAnswer(view, false, count));
+}
+
+TEST(SERVER_PROTOCOL, binary_frames) {
+    std::string frames;
+    server::appendFrame(frames, {'k', -7, 0});
+    server::appendFrame(frames, {'q', -10, 10});
+
+    std::string_view input = std::string_view(frames).substr(0, frames.size() - 1);
+    server::Request req;
+    ASSERT_EQ(server::parseFrame(input, req), server::ParseStatus::request);
+    ASSERT_EQ(req.type, 'k');
+    ASSERT_EQ(req.first, -7);
+    ASSERT_EQ(server::parseFrame(input, req), server::ParseStatus::incomplete);
+
+    input = std::string_view(frames).substr(frames.size() - 13);
+    ASSERT_EQ(server::parseFrame(input, req), server::ParseStatus::request);
+    ASSERT_EQ(req.second, 10);
+
+    std::string bad;
+    server::appendFrame(bad, {'x', 1, 0});
+    input = bad;
+    ASSERT_EQ(server::parseFrame(input, req), server::ParseStatus::malformed);
+
+    std::string answer;
+    server::appendAnswer(answer, true, uint64_t{1} << 40);
+    std::string_view view = answer;
+    std::optional<uint64_t> count;
+    ASSERT_TRUE(server::parseAnswer(view, true, count));
+    ASSERT_EQ(count, uint64_t{1} << 40);
+}
+
+TEST(DURABLE_TREE, recovers_checkpoint_and_wal_tail) {
+    auto directory = std::filesystem::temp_directory_path() / ("avl_durable_" + std::to_string(getpid()));
+    std::filesystem::remove_all(directory);
+
+    std::set<int> reference;
+    std::mt19937 gen(29);
+    std::uniform_int_distribution<int> dist(-100000, 100000);
+    {
+        avl::durable_tree<int> tree(directory, {.group_commit = 64, .checkpoint_interval = 3000});
+        for (int i = 0; i < 10000; ++i) {
+            int key = dist(gen);
+            ASSERT_EQ(tree.insert(key), reference.insert(key).second);
+        }
+    }
+
+    avl::durable_tree<int> recovered(directory);
+    const avl::recovery_info& info = recovered.recovery();
+    ASSERT_EQ(recovered.size(), reference.size());
+    ASSERT_GT(info.checkpoint_keys, 0);
+    ASSERT_LT(info.wal_records, 3000 + 64);
+    ASSERT_EQ(info.checkpoint_keys + info.wal_records, reference.size());
+
+    for (int i = 0; i < 100; ++i) {
+        int first = dist(gen), second = dist(gen);
+        size_t expected = first > second ? 0 : std::distance(reference.lower_bound(first),
+                                                             reference.upper_bound(second));
+        ASSERT_EQ(recovered.range_queries(first, second), expected);
+    }
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST(DURABLE_TREE, cuts_torn_wal_tail) {
+    auto directory = std::filesystem::temp_directory_path() / ("avl_torn_" + std::to_string(getpid()));
+    std::filesystem::remove_all(directory);
+    {
+        avl::durable_tree<int> tree(directory, {.group_commit = 10, .checkpoint_interval = 0});
+        for (int key = 0; key < 25; ++key)
+            tree.insert(key);
+    }
+    {
+        // a group whose write was cut short by a crash
+        std::ofstream wal(directory / "wal", std::ios::binary | std::ios::app);
+        uint32_t count = 5, sum = 0;
+        wal.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        wal.write(reinterpret_cast<const char*>(&sum), sizeof(sum));
+        wal.write("\1\2\3", 3);
+    }
+    {
+        avl::durable_tree<int> tree(directory);
+        ASSERT_EQ(tree.size(), 25);
+        ASSERT_EQ(tree.recovery().torn_bytes, 11);
+        tree.insert(100);
+        tree.checkpoint();
+        tree.insert(101);
+    }
+
+    avl::durable_tree<int> recovered(directory);
+    ASSERT_EQ(recovered.size(), 27);
+    ASSERT_EQ(recovered.recovery().checkpoint_keys, 26);
+    ASSERT_EQ(recovered.recovery().wal_records, 1);
+    ASSERT_EQ(recovered.recovery().torn_bytes, 0);
+
+    std::filesystem::remove_all(directory);
+}
+
+template <typename Node>
+int checkMaxEndpoint(const Node* node) {
+    if (!node)
+        return std::numeric_limits<int>::min();
+
+    int expected = std::max({node->key_.hi, checkMaxEndpoint(node->left_.get()), checkMaxEndpoint(node->right_.get())});
+    EXPECT_EQ(node->augment_, expected);
+    return expected;
+}
+
+TEST(INTERVAL_TREE, random_against_brute_force) {
+    avl::interval_tree<int> tree;
+    std::set<std::pair<int, int>> reference;
+    std::mt19937 gen(31);
+    std::uniform_int_distribution<int> position(0, 10000), length(0, 500);
+
+    for (int i = 0; i < 6000; ++i) {
+        int lo = position(gen), hi = lo + length(gen);
+        ASSERT_EQ(tree.insert(lo, hi), reference.insert({lo, hi}).second);
+
+        if (i % 20 == 0) {
+            int first = position(gen), second = first + length(gen);
+            std::vector<std::pair<int, int>> expected;
+            for (const auto& [lo2, hi2] : reference) {
+                if (lo2 <= second && first <= hi2)
+                    expected.push_back({lo2, hi2});
+            }
+
+            std::vector<std::pair<int, int>> found;
+            tree.for_each_overlapping(first, second, [&found](const avl::interval<int>& it) {
+                found.push_back({it.lo, it.hi});
+            });
+
+            ASSERT_EQ(tree.count_overlapping(first, second), expected.size());
+            ASSERT_EQ(found, expected);
+
+            size_t stabbed = 0;
+            for (const auto& [lo2, hi2] : reference)
+                stabbed += lo2 <= first && first <= hi2;
+            ASSERT_EQ(tree.count_containing(first), stabbed);
+        }
+    }
+
+    ASSERT_FALSE(tree.insert(5, 4));
+    ASSERT_EQ(tree.size(), reference.size());
+    ASSERT_EQ(tree.count_overlapping(std::numeric_limits<int>::min(), std::numeric_limits<int>::max()), reference.size());
+    checkMaxEndpoint(tree.tree().root.get());
+}
+
+TEST(INTERVAL_TREE, infinite_endpoints) {
+    const double infinity = std::numeric_limits<double>::infinity();
+    avl::interval_tree<double> tree;
+    ASSERT_TRUE(tree.insert(-infinity, 5));
+    ASSERT_TRUE(tree.insert(5, infinity));
+    ASSERT_TRUE(tree.insert(-infinity, infinity));
+
+    ASSERT_EQ(tree.count_overlapping(5, 6), 3);
+    ASSERT_EQ(tree.count_overlapping(4, 5), 3);
+    ASSERT_EQ(tree.count_overlapping(6, 7), 2);
+    ASSERT_EQ(tree.count_containing(-1e300), 2);
+    ASSERT_EQ(tree.overlapping(5, 5).size(), 3);
+}
+
+TEST(INTERVAL_TREE, max_endpoint_kept_through_rotations_and_copies) {
+    using tree_type = avl::interval_tree<int>::tree_type;
+    tree_type tree;
+
+    for (int lo = 0; lo < 2000; ++lo)
+        tree.insert({lo, lo + (lo * 7919) % 300});
+    checkMaxEndpoint(tree.root.get());
+
+    tree_type copy{tree};
+    checkMaxEndpoint(copy.root.get());
+
+    copy.compact(avl::CompactOrder::breadth_first);
+    copy.insert({-5, 100000});
+    checkMaxEndpoint(copy.root.get());
+    ASSERT_EQ(copy.root->augment_, 100000);
+
+    std::vector<avl::interval<int>> sorted = {{1, 9}, {2, 3}, {4, 4}, {6, 20}, {7, 8}};
+    auto built = tree_type::build_from_sorted(sorted);
+    checkMaxEndpoint(built.root.get());
+    ASSERT_EQ(built.root->augment_, 20);
+}
+
 
 int main(int argc, char** argv) {
     testing::InitGoogleTest(&argc, argv);
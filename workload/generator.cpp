@@ -0,0 +1,82 @@
+#include "workload.hpp"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+namespace {
+
+void printUsage() {
+    std::cerr << "usage: workload_gen [options] OUTPUT\n"
+                 "  --ops N              number of requests (default 1000000)\n"
+                 "  --insert-ratio R     share of 'k' requests in [0, 1] (default 0.5)\n"
+                 "  --distribution D     uniform | zipf | sequential | clustered | adversarial\n"
+                 "  --min K --max K      key range (default -2000000 2000000)\n"
+                 "  --range-width W      query width; omit for independent bounds\n"
+                 "  --zipf-exponent S    zipf skew (default 1.0)\n"
+                 "  --clusters C         number of clusters (default 64)\n"
+                 "  --cluster-spread S   standard deviation inside a cluster (default 1000)\n"
+                 "  --window-ratio R     share of 'w' window-advance requests (default 0)\n"
+                 "  --window-span S      'w' expires keys below (largest key - S) (default 100000)\n"
+                 "  --seed S             random seed (default 1)\n"
+                 "  --binary             write the binary format instead of text\n";
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    workload::Config config;
+    bool binary = false;
+    std::string output;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string_view option = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("missing value for " + std::string(option));
+                return argv[++i];
+            };
+
+            if      (option == "--ops")            config.operations     = std::stoull(value());
+            else if (option == "--insert-ratio")   config.insert_ratio   = std::stod(value());
+            else if (option == "--distribution")   config.distribution   = workload::parseDistribution(value());
+            else if (option == "--min")            config.min_key        = std::stoi(value());
+            else if (option == "--max")            config.max_key        = std::stoi(value());
+            else if (option == "--range-width")    config.range_width    = std::stoll(value());
+            else if (option == "--zipf-exponent")  config.zipf_exponent  = std::stod(value());
+            else if (option == "--clusters")       config.clusters       = std::stoull(value());
+            else if (option == "--cluster-spread") config.cluster_spread = std::stod(value());
+            else if (option == "--window-ratio")   config.window_ratio   = std::stod(value());
+            else if (option == "--window-span")    config.window_span    = std::stoll(value());
+            else if (option == "--seed")           config.seed           = std::stoull(value());
+            else if (option == "--binary")         binary = true;
+            else if (option.starts_with("--"))     throw std::invalid_argument("unknown option " + std::string(option));
+            else                                   output = option;
+        }
+    }
+    catch (const std::exception& error) {
+        std::cerr << error.what() << "\n";
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    if (output.empty() || config.min_key > config.max_key) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    std::ofstream file(output, binary ? std::ios::binary : std::ios::out);
+    if (!file.is_open()) {
+        std::cerr << "Error opening " << output << "\n";
+        return EXIT_FAILURE;
+    }
+
+    auto requests = workload::generate(config);
+    if (binary)
+        workload::writeBinary(file, requests);
+    else
+        workload::writeText(file, requests);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,151 @@
+#include "workload.hpp"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+struct RunResult {
+    std::string output;
+    double seconds = 0;
+    long peak_rss_kb = 0;
+    bool ok = false;
+};
+
+RunResult runBinary(const std::vector<std::string>& command, const std::string& input_path) {
+    RunResult result;
+
+    int input = open(input_path.c_str(), O_RDONLY);
+    int pipe_fds[2];
+    if (input < 0 || pipe(pipe_fds) != 0) {
+        std::cerr << "cannot open " << input_path << "\n";
+        return result;
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(input, STDIN_FILENO);
+        dup2(pipe_fds[1], STDOUT_FILENO);
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        close(input);
+
+        std::vector<char*> argv;
+        for (const auto& arg : command)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        argv.push_back(nullptr);
+
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+
+    close(input);
+    close(pipe_fds[1]);
+
+    char buffer[1 << 16];
+    ssize_t bytes;
+    while ((bytes = read(pipe_fds[0], buffer, sizeof(buffer))) > 0)
+        result.output.append(buffer, static_cast<size_t>(bytes));
+    close(pipe_fds[0]);
+
+    int status = 0;
+    rusage usage{};
+    wait4(pid, &status, 0, &usage);
+
+    auto end = std::chrono::steady_clock::now();
+    result.seconds = std::chrono::duration<double>(end - begin).count();
+    result.peak_rss_kb = usage.ru_maxrss;
+    result.ok = pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    return result;
+}
+
+// The drivers read text, so binary request files are replayed through a temporary text copy.
+std::string textInput(const std::string& path, size_t& operations, std::string& temporary) {
+    std::ifstream file(path, std::ios::binary);
+    if (!workload::isBinary(file)) {
+        operations = 0;
+        std::string line;
+        while (std::getline(file, line))
+            operations += !line.empty();
+        return path;
+    }
+
+    auto requests = workload::readBinary(file);
+    operations = requests.size();
+
+    char name[] = "/tmp/replay_XXXXXX";
+    int fd = mkstemp(name);
+    if (fd < 0)
+        throw std::runtime_error("cannot create temporary file");
+    close(fd);
+
+    std::ofstream text(name);
+    workload::writeText(text, requests);
+    temporary = name;
+    return temporary;
+}
+
+void report(std::string_view name, const RunResult& run, size_t operations) {
+    std::cout << "  " << std::left << std::setw(9) << name << std::right
+              << std::fixed << std::setprecision(3) << std::setw(10) << run.seconds << " s"
+              << std::setw(14) << std::setprecision(0) << operations / std::max(run.seconds, 1e-9) << " ops/s"
+              << std::setw(10) << run.peak_rss_kb << " KB peak RSS"
+              << (run.ok ? "" : "  (FAILED)") << "\n";
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    std::vector<std::string> avltree = {"avltree/avltree"};
+    std::vector<std::string> stdset  = {"stdset/stdset"};
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view option = argv[i];
+        if (option == "--avltree" && i + 1 < argc)
+            avltree[0] = argv[++i];
+        else if (option == "--avltree-arg" && i + 1 < argc)
+            avltree.push_back(argv[++i]);
+        else if (option == "--stdset" && i + 1 < argc)
+            stdset[0] = argv[++i];
+        else
+            files.emplace_back(option);
+    }
+
+    if (files.empty()) {
+        std::cerr << "usage: replay [--avltree PATH] [--avltree-arg ARG]... [--stdset PATH] FILE...\n";
+        return EXIT_FAILURE;
+    }
+
+    bool all_match = true;
+    for (const auto& path : files) {
+        size_t operations = 0;
+        std::string temporary;
+        std::string input = textInput(path, operations, temporary);
+
+        RunResult avl_run = runBinary(avltree, input);
+        RunResult set_run = runBinary(stdset, input);
+        bool match = avl_run.ok && set_run.ok && avl_run.output == set_run.output;
+        all_match = all_match && match;
+
+        std::cout << path << ": " << operations << " requests, outputs " << (match ? "match" : "DIFFER") << "\n";
+        report("avltree", avl_run, operations);
+        report("stdset", set_run, operations);
+
+        if (!temporary.empty())
+            unlink(temporary.c_str());
+    }
+
+    return all_match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
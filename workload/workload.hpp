@@ -0,0 +1,234 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace workload {
+
+static constexpr char key_request    = 'k';
+static constexpr char query_request  = 'q';
+static constexpr char window_request = 'w';
+
+// Binary request file: magic, record count, then packed {type, first, second} records.
+static constexpr char BINARY_MAGIC[4] = {'A', 'V', 'L', 'W'};
+
+struct Request {
+    char type;
+    int32_t first;
+    int32_t second;
+};
+
+enum class Distribution {
+    uniform,
+    zipf,
+    sequential,
+    clustered,
+    adversarial
+};
+
+struct Config {
+    size_t operations     = 1000000;
+    double insert_ratio   = 0.5;
+    Distribution distribution = Distribution::uniform;
+    int32_t min_key       = -2000000;
+    int32_t max_key       =  2000000;
+    int64_t range_width   = -1;      // < 0: both query bounds drawn independently
+    double zipf_exponent  = 1.0;
+    size_t zipf_keys      = 1 << 20; // distinct hot keys for zipf
+    size_t clusters       = 64;
+    double cluster_spread = 1000.0;
+    double window_ratio   = 0.0;     // share of 'w' requests
+    int64_t window_span   = 100000;  // 'w' expires keys older than (largest key so far - span)
+    uint64_t seed         = 1;
+};
+
+inline Distribution parseDistribution(const std::string& name) {
+    if (name == "uniform")     return Distribution::uniform;
+    if (name == "zipf")        return Distribution::zipf;
+    if (name == "sequential")  return Distribution::sequential;
+    if (name == "clustered")   return Distribution::clustered;
+    if (name == "adversarial") return Distribution::adversarial;
+    throw std::invalid_argument("unknown distribution: " + name);
+}
+
+class KeyGenerator final {
+ private:
+    Config config_;
+    std::mt19937_64 gen_;
+    std::vector<double> zipf_cdf_;
+    std::vector<int32_t> centres_;
+    int64_t sequence_ = 0;
+
+ public:
+    explicit KeyGenerator(const Config& config) : config_(config), gen_(config.seed) {
+        if (config_.distribution == Distribution::zipf) {
+            zipf_cdf_.resize(std::max<size_t>(config_.zipf_keys, 1));
+            double sum = 0;
+            for (size_t rank = 0; rank < zipf_cdf_.size(); ++rank) {
+                sum += 1.0 / std::pow(static_cast<double>(rank + 1), config_.zipf_exponent);
+                zipf_cdf_[rank] = sum;
+            }
+            for (auto& value : zipf_cdf_)
+                value /= sum;
+        }
+
+        if (config_.distribution == Distribution::clustered) {
+            centres_.resize(std::max<size_t>(config_.clusters, 1));
+            for (auto& centre : centres_)
+                centre = uniform();
+        }
+    }
+
+    int32_t next() {
+        switch (config_.distribution) {
+            case Distribution::uniform:
+                return uniform();
+            case Distribution::zipf:
+                return zipf();
+            case Distribution::sequential:
+                return clamp(config_.min_key + sequence_++);
+            case Distribution::clustered:
+                return clustered();
+            case Distribution::adversarial: { // zig-zag from both ends towards the middle
+                int64_t step = sequence_++;
+                return clamp(step % 2 ? config_.max_key - step / 2 : config_.min_key + step / 2);
+            }
+        }
+        return uniform();
+    }
+
+    int32_t uniform() {
+        return std::uniform_int_distribution<int32_t>(config_.min_key, config_.max_key)(gen_);
+    }
+
+ private:
+    int32_t clamp(int64_t key) const noexcept {
+        return static_cast<int32_t>(std::clamp<int64_t>(key, config_.min_key, config_.max_key));
+    }
+
+    int32_t zipf() {
+        double point = std::uniform_real_distribution<double>(0.0, 1.0)(gen_);
+        auto rank = static_cast<uint64_t>(std::lower_bound(zipf_cdf_.begin(), zipf_cdf_.end(), point)
+                                          - zipf_cdf_.begin());
+
+        // scatter ranks over the key range so hot keys are not adjacent
+        uint64_t span = static_cast<uint64_t>(int64_t{config_.max_key} - config_.min_key) + 1;
+        uint64_t hashed = (rank + 1) * 0x9E3779B97F4A7C15ull;
+        return clamp(config_.min_key + static_cast<int64_t>((hashed ^ (hashed >> 29)) % span));
+    }
+
+    int32_t clustered() {
+        size_t index = std::uniform_int_distribution<size_t>(0, centres_.size() - 1)(gen_);
+        double offset = std::normal_distribution<double>(0.0, config_.cluster_spread)(gen_);
+        return clamp(centres_[index] + std::llround(offset));
+    }
+};
+
+inline std::vector<Request> generate(const Config& config) {
+    KeyGenerator keys(config);
+    std::mt19937_64 gen(config.seed ^ 0x5DEECE66Dull);
+    std::bernoulli_distribution is_insert(config.insert_ratio);
+
+    std::bernoulli_distribution is_window(config.window_ratio);
+
+    std::vector<Request> requests;
+    requests.reserve(config.operations);
+    int64_t largest = config.min_key;
+
+    for (size_t i = 0; i < config.operations; ++i) {
+        if (config.window_ratio > 0 && is_window(gen)) {
+            int64_t horizon = std::max<int64_t>(largest - config.window_span, config.min_key);
+            requests.push_back({window_request, static_cast<int32_t>(horizon), 0});
+            continue;
+        }
+
+        if (is_insert(gen)) {
+            int32_t key = keys.next();
+            largest = std::max<int64_t>(largest, key);
+            requests.push_back({key_request, key, 0});
+            continue;
+        }
+
+        int32_t first = keys.next();
+        int32_t second;
+        if (config.range_width < 0) {
+            second = keys.uniform();
+        }
+        else {
+            int64_t width = std::uniform_int_distribution<int64_t>(0, config.range_width)(gen);
+            second = static_cast<int32_t>(std::min<int64_t>(first + width, config.max_key));
+        }
+        requests.push_back({query_request, first, second});
+    }
+
+    return requests;
+}
+
+inline void writeText(std::ostream& out, const std::vector<Request>& requests) {
+    std::string text;
+    for (const auto& req : requests) {
+        text += req.type;
+        text += ' ';
+        text += std::to_string(req.first);
+        if (req.type == query_request) {
+            text += ' ';
+            text += std::to_string(req.second);
+        }
+        text += '\n';
+
+        if (text.size() > (1 << 20)) {
+            out.write(text.data(), static_cast<std::streamsize>(text.size()));
+            text.clear();
+        }
+    }
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+inline void writeBinary(std::ostream& out, const std::vector<Request>& requests) {
+    uint64_t count = requests.size();
+    out.write(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+    for (const auto& req : requests) {
+        out.write(&req.type, sizeof(req.type));
+        out.write(reinterpret_cast<const char*>(&req.first),  sizeof(req.first));
+        out.write(reinterpret_cast<const char*>(&req.second), sizeof(req.second));
+    }
+}
+
+inline bool isBinary(std::istream& in) {
+    char magic[sizeof(BINARY_MAGIC)] = {};
+    in.read(magic, sizeof(magic));
+    bool binary = in.gcount() == sizeof(magic) && std::memcmp(magic, BINARY_MAGIC, sizeof(magic)) == 0;
+
+    in.clear();
+    in.seekg(0);
+    return binary;
+}
+
+inline std::vector<Request> readBinary(std::istream& in) {
+    char magic[sizeof(BINARY_MAGIC)];
+    uint64_t count = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+
+    std::vector<Request> requests(count);
+    for (auto& req : requests) {
+        in.read(&req.type, sizeof(req.type));
+        in.read(reinterpret_cast<char*>(&req.first),  sizeof(req.first));
+        in.read(reinterpret_cast<char*>(&req.second), sizeof(req.second));
+    }
+
+    if (!in)
+        throw std::runtime_error("truncated binary request file");
+    return requests;
+}
+
+} // namespace workload